@@ -1,14 +1,8 @@
 #include "array.h"
+#include "heap.h"
 
-size_t allocated_array = 0;
-
-#define MALLOC(size) \
-    ({  allocated_array += size; \
-        malloc(size); })
-
-#define FREE(ptr) \
-    ({  allocated_array -= sizeof(*(__typeof__(ptr)){NULL}); \
-        free(ptr); })
+#define MALLOC(size) heapAlloc(HEAP_ARRAY, size)
+#define FREE(ptr) heapFree(HEAP_ARRAY, ptr, sizeof(*(ptr)))
 
 Array* newArray(void) {
     Array* array = MALLOC(sizeof(Array));
@@ -29,10 +23,9 @@ void destroyArray(Array* array, void (*freeValue)(void*)) {
     void* value;
     arrayForeach(array, value, _i) {
         freeValue(value);
-        allocated_array -= sizeof(void*);
     }
 
-    FREE(array->buffer);
+    heapFree(HEAP_ARRAY, array->buffer, array->capacity * sizeof(void*));
     FREE(array);
 }
 
@@ -43,10 +36,10 @@ void* arrayGet(Array* array, int i) {
 
 ArrayErr arrayAppend(Array* array, void* value) {
     if (array->length + 1 > array->capacity) {
-        void** ptr = realloc(array->buffer, (array->capacity + RESIZE_CAPACITY) * sizeof(void*));
+        void** ptr = heapRealloc(HEAP_ARRAY, array->buffer, array->capacity * sizeof(void*),
+                (array->capacity + RESIZE_CAPACITY) * sizeof(void*));
         if (!ptr) return ARRAY_REALLOC_ERR;
 
-        allocated_array += RESIZE_CAPACITY * sizeof(void*);
         array->capacity += RESIZE_CAPACITY;
         array->buffer = ptr;
     }
@@ -63,10 +56,10 @@ ArrayErr arrayDelete(Array* array, int i, void (*freeValue)(void*)) {
     }
 
     if (array->length < array->capacity - RESIZE_CAPACITY) {
-        void** ptr = realloc(array->buffer, (array->capacity - RESIZE_CAPACITY) * sizeof(void*));
+        void** ptr = heapRealloc(HEAP_ARRAY, array->buffer, array->capacity * sizeof(void*),
+                (array->capacity - RESIZE_CAPACITY) * sizeof(void*));
         if (!ptr) return ARRAY_REALLOC_ERR;
 
-        allocated_array -= RESIZE_CAPACITY * sizeof(void*);
         array->capacity -= RESIZE_CAPACITY;
         array->buffer = ptr;
     }
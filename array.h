@@ -23,8 +23,6 @@ extern "C" {
 
 #include <stdlib.h>
 
-extern size_t allocated_array;
-
 typedef struct {
     int length;
     int capacity;
@@ -0,0 +1,55 @@
+#include "baud.h"
+
+BaudConfig baudCompute(uint32_t clkFreq, uint32_t baud) {
+    BaudConfig config = BAUD_CONFIG(clkFreq, baud);
+    return config;
+}
+
+void baudApply(EUSCI_A_Type* eusci, const BaudConfig* config) {
+    eusci->BRW = config->brw;
+    eusci->MCTLW = (config->brf << EUSCI_A_MCTLW_BRF_OFS)
+            | (config->brs << EUSCI_A_MCTLW_BRS_OFS)
+            | (config->os16 ? EUSCI_A_MCTLW_OS16 : 0);
+}
+
+// Number of set bits in the modulation pattern, i.e. extra BRCLK cycles per 8 bits
+int modulationBits(uint8_t brs) {
+    int bits = 0;
+    for (; brs; brs >>= 1) {
+        bits += brs & 1;
+    }
+    return bits;
+}
+
+uint32_t baudActual(uint32_t clkFreq, const BaudConfig* config) {
+    // Average BRCLK cycles per bit, scaled by 8 to keep the UCBRSx contribution exact
+    uint32_t cycles = config->os16
+            ? 8 * (16 * config->brw + config->brf)
+            : 8 * config->brw;
+    cycles += modulationBits(config->brs);
+
+    return (uint32_t)((uint64_t)clkFreq * 8 / cycles);
+}
+
+int32_t baudErrorPPM(uint32_t clkFreq, const BaudConfig* config) {
+    int64_t actual = baudActual(clkFreq, config);
+    return (int32_t)((actual - config->baud) * 1000000 / config->baud);
+}
+
+void testBaud(void) {
+    // Should match the original hand-computed settings: BRW = 78, BRF = 2, BRS = 0, OS16
+    BaudConfig slow = baudCompute(48000000, 38400);
+    int32_t slowErr = baudErrorPPM(48000000, &slow);
+
+    // BRW = 26, BRF = 0, BRS = 0xB6, OS16, about 95 ppm fast
+    BaudConfig fast = baudCompute(48000000, 115200);
+    int32_t fastErr = baudErrorPPM(48000000, &fast);
+
+    // BRW = 3, BRF = 0, BRS = 0, OS16
+    BaudConfig fastest = baudCompute(48000000, 1000000);
+    int32_t fastestErr = baudErrorPPM(48000000, &fastest);
+
+    // N <= 16 uses low frequency mode: BRW = 13, BRS = 0, about 0.16% fast
+    BaudConfig lowFreq = baudCompute(1500000, 115200);
+    int32_t lowFreqErr = baudErrorPPM(1500000, &lowFreq);
+}
@@ -0,0 +1,87 @@
+/*
+ * baud.h
+ *
+ *      Description: eUSCI_A baud rate generator settings for any BRCLK and baud
+ *                   rate, following Section 24.3.10 of the Technical Reference
+ *                   Manual. BAUD_CONFIG evaluates entirely at compile time for
+ *                   constant arguments; baudCompute does the same at runtime.
+ *
+ *      Author: gibbonec
+ */
+
+#ifndef BAUD_H_
+#define BAUD_H_
+
+#include "msp.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint32_t baud;  // Target baud rate
+    uint16_t brw;   // UCBRx
+    uint8_t brf;    // UCBRFx, only used with oversampling
+    uint8_t brs;    // UCBRSx modulation pattern
+    bool os16;      // Oversampling mode
+} BaudConfig;
+
+/* N = BRCLK / baud, and the fractional part of N scaled by 10000 */
+#define BAUD_N(clk, baud)           ((clk) / (baud))
+#define BAUD_FRAC(clk, baud)        ((uint32_t)((uint64_t)((clk) % (baud)) * 10000 / (baud)))
+
+/* Oversampling is used whenever N > 16 */
+#define BAUD_OS16(clk, baud)        (BAUD_N(clk, baud) > 16)
+#define BAUD_BRW(clk, baud)         (BAUD_OS16(clk, baud) ? (clk) / (16 * (baud)) : BAUD_N(clk, baud))
+#define BAUD_BRF(clk, baud)         (BAUD_OS16(clk, baud) ? ((clk) % (16 * (baud))) / (baud) : 0)
+
+/* UCBRSx from the fractional part of N, per Table 24-4 of the Technical Reference Manual */
+#define BAUD_BRS_FRAC(f) \
+    ((f) >= 9288 ? 0xFE : (f) >= 9170 ? 0xFD : (f) >= 9004 ? 0xFB : (f) >= 8751 ? 0xF7 : \
+     (f) >= 8572 ? 0xEF : (f) >= 8464 ? 0xDF : (f) >= 8333 ? 0xBF : (f) >= 8004 ? 0xEE : \
+     (f) >= 7861 ? 0xED : (f) >= 7503 ? 0xDD : (f) >= 7147 ? 0xBB : (f) >= 7001 ? 0xB7 : \
+     (f) >= 6667 ? 0xD6 : (f) >= 6432 ? 0xB6 : (f) >= 6254 ? 0xB5 : (f) >= 6003 ? 0xAD : \
+     (f) >= 5715 ? 0x6B : (f) >= 5002 ? 0xAA : (f) >= 4378 ? 0x55 : (f) >= 4286 ? 0x53 : \
+     (f) >= 4003 ? 0x92 : (f) >= 3753 ? 0x52 : (f) >= 3575 ? 0x4A : (f) >= 3335 ? 0x49 : \
+     (f) >= 3000 ? 0x25 : (f) >= 2503 ? 0x44 : (f) >= 2224 ? 0x22 : (f) >= 2147 ? 0x21 : \
+     (f) >= 1670 ? 0x11 : (f) >= 1430 ? 0x20 : (f) >= 1252 ? 0x10 : (f) >= 1001 ? 0x08 : \
+     (f) >= 835 ? 0x04 : (f) >= 715 ? 0x02 : (f) >= 529 ? 0x01 : 0x00)
+#define BAUD_BRS(clk, baud)         BAUD_BRS_FRAC(BAUD_FRAC(clk, baud))
+
+/* Initializer for a BaudConfig, constant for constant arguments */
+#define BAUD_CONFIG(clk, baud) \
+    { (baud), BAUD_BRW(clk, baud), BAUD_BRF(clk, baud), BAUD_BRS(clk, baud), BAUD_OS16(clk, baud) }
+
+/*
+ * Computes the baud rate generator settings for the given BRCLK and baud rate
+ *  in Hz. The baud rate must be at most BRCLK / 3.
+ */
+BaudConfig baudCompute(uint32_t clkFreq, uint32_t baud);
+
+/*
+ * Writes the settings to the eUSCI_A module, which must be held in reset
+ *  (UCSWRST set).
+ */
+void baudApply(EUSCI_A_Type* eusci, const BaudConfig* config);
+
+/*
+ * Returns the baud rate the settings actually produce from the given BRCLK,
+ *  averaged over the UCBRSx modulation pattern.
+ */
+uint32_t baudActual(uint32_t clkFreq, const BaudConfig* config);
+
+/*
+ * Returns the error of the achieved baud rate in parts per million, negative
+ *  if the achieved rate is slow.
+ */
+int32_t baudErrorPPM(uint32_t clkFreq, const BaudConfig* config);
+
+void testBaud(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BAUD_H_ */
@@ -0,0 +1,149 @@
+#include "clock.h"
+#include "timebase.h"
+#include "profile.h"
+#include "trace.h"
+#include "timer.h"
+
+#define CLOCK_CONFIG(state, name, mclkDivider, mclk, vcore, waitStates) \
+    { name, mclkDivider, mclk, vcore, waitStates },
+
+const ClockConfig clockConfigs[NUM_CLOCK_STATES] = {
+    CLOCK_STATES(CLOCK_CONFIG)
+};
+
+ClockStats clockStats;
+
+ClockState clockCurrent = CLOCK_BOOST;
+uint64_t clockSince = 0;    // Microseconds at the last switch
+
+void holdExpired(Timer* timer);
+Timer holdTimer = TIMER(holdExpired);   // Runs while boosted, until CLOCK_HOLD ms after the last boost
+
+ClockListener clockListeners[MAX_CLOCK_LISTENERS];
+int clockListenerCount = 0;
+
+// Sets the core voltage, returning false if the PCM refused the transition
+bool setVCORE(uint32_t vcore) {
+    PCM->CTL0 = PCM_CTL0_KEY_VAL | vcore;
+    while (PCM->CTL1 & PCM_CTL1_PMR_BUSY);
+
+    if (PCM->IFG & PCM_IFG_AM_INVALID_TR_IFG) {
+        PCM->CLRIFG = PCM_CLRIFG_CLR_AM_INVALID_TR_IFG;
+        return false;
+    }
+    return true;
+}
+
+void setWaitStates(uint32_t waitStates) {
+    FLCTL_A->BANK0_RDCTL = (FLCTL_A->BANK0_RDCTL & ~FLCTL_A_BANK0_RDCTL_WAIT_MASK)
+            | (waitStates << FLCTL_A_BANK0_RDCTL_WAIT_OFS);
+    FLCTL_A->BANK1_RDCTL = (FLCTL_A->BANK1_RDCTL & ~FLCTL_A_BANK1_RDCTL_WAIT_MASK)
+            | (waitStates << FLCTL_A_BANK1_RDCTL_WAIT_OFS);
+}
+
+// Changes MCLK, and everything derived from it before anything can run at the wrong rate
+void switchClock(ClockState state) {
+    const ClockConfig* config = &clockConfigs[state];
+    uint32_t previous = clockConfigs[clockCurrent].mclk;
+    uint64_t now = nowMicros();
+    int i;
+
+    __disable_irq();
+    CS->KEY = CS_KEY_VAL;
+    CS->CTL1 = (CS->CTL1 & ~CS_CTL1_DIVM_MASK) | config->mclkDivider;
+    CS->KEY = 0;
+
+    timebaseClock(config->mclk);
+    for (i = 0; i < clockListenerCount; i++) {
+        clockListeners[i](config->mclk, SMCLK_FREQUENCY);
+    }
+    __enable_irq();
+
+    clockStats.micros[clockCurrent] += now - clockSince;
+    clockStats.switches++;
+    clockSince = now;
+    clockCurrent = state;
+    TRACE(TRACE_CLOCK, config->mclk / 1000000, previous / 1000000);
+}
+
+void initClock(void) {
+    // Bring SMCLK and HSMCLK down to what VCORE0 allows, MCLK stays at 48 MHz for now
+    CS->KEY = CS_KEY_VAL;
+    CS->CTL1 = (CS->CTL1 & ~(CS_CTL1_DIVS_MASK | CS_CTL1_DIVHS_MASK)) | CS_CTL1_DIVS__4 | CS_CTL1_DIVHS__4;
+    CS->KEY = 0;
+
+    clockCurrent = CLOCK_BOOST;
+    clockSince = nowMicros();
+    timerStart(&holdTimer, CLOCK_HOLD, 0);
+}
+
+bool clockSubscribe(ClockListener listener) {
+    if (clockListenerCount >= MAX_CLOCK_LISTENERS) return false;
+    clockListeners[clockListenerCount++] = listener;
+    return true;
+}
+
+void clockBoost(void) {
+    timerStart(&holdTimer, CLOCK_HOLD, 0);
+    if (clockCurrent == CLOCK_BOOST) return;
+
+    // Raise the core voltage and wait states before the frequency
+    const ClockConfig* boost = &clockConfigs[CLOCK_BOOST];
+    if (!setVCORE(boost->vcore)) {
+        clockStats.failures++;
+        return;
+    }
+    setWaitStates(boost->waitStates);
+    switchClock(CLOCK_BOOST);
+}
+
+void clockIdle(void) {
+    timerStop(&holdTimer);
+    if (clockCurrent == CLOCK_IDLE) return;
+
+    // Lower the frequency before the wait states and core voltage. Staying at
+    //  VCORE1 is harmless if the PCM refuses
+    const ClockConfig* idle = &clockConfigs[CLOCK_IDLE];
+    switchClock(CLOCK_IDLE);
+    setWaitStates(idle->waitStates);
+    setVCORE(idle->vcore);
+}
+
+void holdExpired(Timer* timer) {
+    clockIdle();
+}
+
+inline ClockState clockState(void) {
+    return clockCurrent;
+}
+
+inline uint32_t clockMCLK(void) {
+    return clockConfigs[clockCurrent].mclk;
+}
+
+uint64_t clockMicros(ClockState state) {
+    uint64_t micros = clockStats.micros[state];
+    if (state == clockCurrent) micros += nowMicros() - clockSince;
+    return micros;
+}
+
+inline const char* clockName(ClockState state) {
+    return clockConfigs[state].name;
+}
+
+void testClock(void) {
+    // A 1 ms deadline should take 48000 cycles boosted and 12000 idle, so the
+    //  timebase keeps real time in both. Check the counts here
+    clockBoost();
+    uint32_t start = profileNow();
+    waitUntil(deadlineAfter(1000));
+    uint32_t boostCycles = profileNow() - start;
+
+    clockIdle();
+    ClockState state = clockState();                // Should be CLOCK_IDLE
+    start = profileNow();
+    waitUntil(deadlineAfter(1000));
+    uint32_t idleCycles = profileNow() - start;
+
+    clockBoost();
+}
@@ -0,0 +1,119 @@
+/*
+ * clock.h
+ *
+ *      Description: Clock policy. The device idles with MCLK divided down
+ *                   and the core at VCORE0, and boosts to the full 48 MHz
+ *                   at VCORE1 while there is work to do, e.g. a response
+ *                   to parse. Each state sets the dividers, core voltage and
+ *                   flash wait states:
+ *
+ *                   X(state, name, mclkDivider, mclk, vcore, waitStates)
+ *
+ *                   Both states divide HFXT, which keeps running, so a
+ *                   switch takes effect at once and the clocks keep the
+ *                   crystal's accuracy. SMCLK stays at HFXT / 4 throughout,
+ *                   the most VCORE0 allows peripherals, so the UART and LCD
+ *                   timer never change rate under a byte or a wait.
+ *
+ *                   The timebase is rescaled on every switch, and listeners
+ *                   are told the new frequencies to recompute what they
+ *                   derive from them.
+ *
+ *      Author: gibbonec
+ */
+
+#ifndef CLOCK_H_
+#define CLOCK_H_
+
+#include "msp.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HFXT_FREQUENCY  48000000
+#define SMCLK_FREQUENCY (HFXT_FREQUENCY / 4)
+
+#define CLOCK_HOLD      20      // Milliseconds to stay boosted after the last request
+#define MAX_CLOCK_LISTENERS 4
+
+// Wait states per Section 5.8 of the data sheet, 1 covers up to 24 MHz at VCORE0
+#define CLOCK_STATES(X) \
+    X(CLOCK_IDLE,  "idle",  CS_CTL1_DIVM__4, HFXT_FREQUENCY / 4, PCM_CTL0_AMR_0, 1) \
+    X(CLOCK_BOOST, "boost", CS_CTL1_DIVM__1, HFXT_FREQUENCY,     PCM_CTL0_AMR_1, 3)
+
+#define CLOCK_ENUM(state, name, mclkDivider, mclk, vcore, waitStates) state,
+
+typedef enum {
+    CLOCK_STATES(CLOCK_ENUM)
+    NUM_CLOCK_STATES,
+} ClockState;
+
+typedef struct {
+    const char* name;
+    uint32_t mclkDivider;   // CS_CTL1_DIVM__x
+    uint32_t mclk;          // Hz
+    uint32_t vcore;         // PCM_CTL0_AMR_x, LDO
+    uint32_t waitStates;
+} ClockConfig;
+
+/*
+ * Called after every switch, with interrupts masked, to recompute settings
+ *  derived from MCLK or SMCLK. Must be quick.
+ */
+typedef void (*ClockListener)(uint32_t mclk, uint32_t smclk);
+
+typedef struct {
+    uint64_t micros[NUM_CLOCK_STATES];  // Time spent in each state, up to the last switch
+    uint32_t switches;
+    uint32_t failures;                  // Boosts abandoned because the core voltage didn't rise
+} ClockStats;
+
+extern ClockStats clockStats;
+
+/*
+ * Takes over from configHFXT, which leaves MCLK and SMCLK at 48 MHz, starting
+ *  boosted with SMCLK at SMCLK_FREQUENCY. Call before anything uses SMCLK,
+ *  after initTimebase and initTimers.
+ */
+void initClock(void);
+
+/*
+ * Adds a listener, returning false if there's no room.
+ */
+bool clockSubscribe(ClockListener listener);
+
+/*
+ * Switches to the boost state if not already there, and stays until
+ *  CLOCK_HOLD ms after the last call.
+ */
+void clockBoost(void);
+
+/*
+ * Drops back to idle at once. Runs when the hold runs out.
+ */
+void clockIdle(void);
+
+ClockState clockState(void);
+
+/*
+ * Returns the current MCLK frequency in Hz.
+ */
+uint32_t clockMCLK(void);
+
+/*
+ * Returns the time in microseconds spent in a state, including now.
+ */
+uint64_t clockMicros(ClockState state);
+
+const char* clockName(ClockState state);
+
+void testClock(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CLOCK_H_ */
@@ -0,0 +1,27 @@
+#include "condition.h"
+#include "format.h"
+
+#define CONDITION_INDEX(code) (((code) - CONDITION_FIRST_CODE) / CONDITION_CODE_STEP)
+
+#define CONDITION_ENTRY(code, abbreviation, glyph) [CONDITION_INDEX(code)] = {abbreviation, glyph},
+
+// Indexed by CONDITION_INDEX, with gaps for unused codes
+const Condition conditions[NUM_CONDITION_CODES] = {
+    CONDITIONS(CONDITION_ENTRY)
+};
+
+// Every code must land on a row of the table, with an abbreviation that fits
+#define CONDITION_CHECK(code, abbreviation, glyph) \
+    STATIC_ASSERT(sizeof(abbreviation) - 1 <= CONDITION_COLUMNS, condition_##code##_fits); \
+    STATIC_ASSERT((code) >= CONDITION_FIRST_CODE && ((code) - CONDITION_FIRST_CODE) % CONDITION_CODE_STEP == 0 \
+            && CONDITION_INDEX(code) < NUM_CONDITION_CODES, condition_##code##_index);
+
+CONDITIONS(CONDITION_CHECK)
+
+const Condition* conditionLookup(int code) {
+    unsigned int offset = code - CONDITION_FIRST_CODE;
+    if (offset % CONDITION_CODE_STEP != 0 || offset / CONDITION_CODE_STEP >= NUM_CONDITION_CODES) return NULL;
+
+    const Condition* condition = &conditions[offset / CONDITION_CODE_STEP];
+    return condition->abbreviation ? condition : NULL;
+}
@@ -0,0 +1,95 @@
+/*
+ * condition.h
+ *
+ *      Description: Table of weather condition codes, with an abbreviation
+ *                   short enough to follow an icon on a line and the glyph for
+ *                   the icon. Codes run from 1000 in steps of 3, so a lookup is
+ *                   a single index into the table. Each row of CONDITIONS is
+ *                   checked at compile time.
+ *
+ *                   Codes and texts from
+ *                   https://www.weatherapi.com/docs/weather_conditions.json
+ *
+ *      Author: gibbonec
+ */
+
+#ifndef CONDITION_H_
+#define CONDITION_H_
+
+#include "glyph.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CONDITION_COLUMNS 14    // Line less the icon and a space
+#define CONDITION_FIRST_CODE 1000
+#define CONDITION_CODE_STEP 3
+#define NUM_CONDITION_CODES 95  // Codes 1000 to 1282
+
+// X(code, abbreviation, glyph)
+#define CONDITIONS(X) \
+    X(1000, "Clear",          GLYPH_SUN)            \
+    X(1003, "Partly cloudy",  GLYPH_PARTLY_CLOUDY)  \
+    X(1006, "Cloudy",         GLYPH_CLOUD)          \
+    X(1009, "Overcast",       GLYPH_CLOUD)          \
+    X(1030, "Mist",           GLYPH_FOG)            \
+    X(1063, "Patchy rain",    GLYPH_RAIN)           \
+    X(1066, "Patchy snow",    GLYPH_SNOW)           \
+    X(1069, "Patchy sleet",   GLYPH_RAIN)           \
+    X(1072, "Frz drizzle",    GLYPH_RAIN)           \
+    X(1087, "Thunder",        GLYPH_THUNDER)        \
+    X(1114, "Blowing snow",   GLYPH_SNOW)           \
+    X(1117, "Blizzard",       GLYPH_SNOW)           \
+    X(1135, "Fog",            GLYPH_FOG)            \
+    X(1147, "Freezing fog",   GLYPH_FOG)            \
+    X(1150, "Lt drizzle",     GLYPH_RAIN)           \
+    X(1153, "Light drizzle",  GLYPH_RAIN)           \
+    X(1168, "Frz drizzle",    GLYPH_RAIN)           \
+    X(1171, "Heavy frz driz", GLYPH_RAIN)           \
+    X(1180, "Patchy lt rain", GLYPH_RAIN)           \
+    X(1183, "Light rain",     GLYPH_RAIN)           \
+    X(1186, "Moderate rain",  GLYPH_RAIN)           \
+    X(1189, "Moderate rain",  GLYPH_RAIN)           \
+    X(1192, "Heavy rain",     GLYPH_RAIN)           \
+    X(1195, "Heavy rain",     GLYPH_RAIN)           \
+    X(1198, "Lt frz rain",    GLYPH_RAIN)           \
+    X(1201, "Freezing rain",  GLYPH_RAIN)           \
+    X(1204, "Light sleet",    GLYPH_RAIN)           \
+    X(1207, "Heavy sleet",    GLYPH_RAIN)           \
+    X(1210, "Patchy lt snow", GLYPH_SNOW)           \
+    X(1213, "Light snow",     GLYPH_SNOW)           \
+    X(1216, "Patchy snow",    GLYPH_SNOW)           \
+    X(1219, "Moderate snow",  GLYPH_SNOW)           \
+    X(1222, "Patch hvy snow", GLYPH_SNOW)           \
+    X(1225, "Heavy snow",     GLYPH_SNOW)           \
+    X(1237, "Ice pellets",    GLYPH_SNOW)           \
+    X(1240, "Lt rain shower", GLYPH_RAIN)           \
+    X(1243, "Rain showers",   GLYPH_RAIN)           \
+    X(1246, "Downpour",       GLYPH_RAIN)           \
+    X(1249, "Sleet shower",   GLYPH_RAIN)           \
+    X(1252, "Hvy sleet shwr", GLYPH_RAIN)           \
+    X(1255, "Lt snow shower", GLYPH_SNOW)           \
+    X(1258, "Snow showers",   GLYPH_SNOW)           \
+    X(1261, "Lt ice pellets", GLYPH_SNOW)           \
+    X(1264, "Hvy ice pellet", GLYPH_SNOW)           \
+    X(1273, "Lt rain+thndr",  GLYPH_THUNDER)        \
+    X(1276, "Hvy rain+thndr", GLYPH_THUNDER)        \
+    X(1279, "Lt snow+thndr",  GLYPH_THUNDER)        \
+    X(1282, "Hvy snow+thndr", GLYPH_THUNDER)
+
+typedef struct {
+    const char* abbreviation;
+    Glyph glyph;
+} Condition;
+
+/*
+ * Returns the table entry for a condition code, or NULL for an unknown code.
+ */
+const Condition* conditionLookup(int code);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CONDITION_H_ */
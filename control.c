@@ -0,0 +1,279 @@
+#include "control.h"
+#include "frame.h"
+#include "uart.h"
+#include "request.h"
+#include "lcd.h"
+#include "glyph.h"
+#include "notify.h"
+#include "profile.h"
+#include "trace.h"
+#include "heap.h"
+#include "stack.h"
+#include "clock.h"
+#include "event.h"
+#include "task.h"
+#include "timer.h"
+#include <string.h>
+#include <stdio.h>
+
+char command[COMMAND_SIZE];
+int command_i = 0;
+bool commandOverflow = false;
+
+uint32_t pendingBaud = 0;
+
+// Sends a NUL-terminated reply on the control channel
+void reply(const char* message) {
+    frameSend(CHANNEL_CONTROL, message, strlen(message) + 1);
+}
+
+// Parses a non-negative decimal number, or returns -1
+long parseDecimal(const char* str) {
+    if (*str == '\0') return -1;
+
+    long value = 0;
+    for (; *str != '\0'; str++) {
+        if (*str < '0' || *str > '9') return -1;
+        value = value * 10 + *str - '0';
+    }
+    return value;
+}
+
+// Sends a report line on the telemetry channel, transmitting what's queued first if it doesn't fit
+void sendReport(const char* report) {
+    if (!frameSend(CHANNEL_TELEMETRY, report, strlen(report) + 1)) {
+        frameProcess();
+        frameSend(CHANNEL_TELEMETRY, report, strlen(report) + 1);
+    }
+}
+
+void replyRequestErr(RequestErr err) {
+    switch (err) {
+    case LOCATION_FULL_ERR:
+        reply("ERR full");
+        break;
+    case LOCATION_INDEX_ERR:
+        reply("ERR slot");
+        break;
+    case LOCATION_CHAR_ERR:
+        reply("ERR query");
+        break;
+    case LOCATION_LAST_ERR:
+        reply("ERR last");
+        break;
+    case REQUEST_LEN_ERR:
+        reply("ERR length");
+        break;
+    default:
+        reply("OK");
+    }
+}
+
+void execute(char* cmd) {
+    if (strcmp(cmd, "BAUD OK") == 0) {
+        // Forwarder accepted the new rate and has already switched
+        if (pendingBaud) {
+            setBaud(pendingBaud);
+            pendingBaud = 0;
+        }
+    } else if (strncmp(cmd, "LOC+ ", 5) == 0) {
+        replyRequestErr(addLocation(&cmd[5]));
+    } else if (strncmp(cmd, "LOC- ", 5) == 0) {
+        replyRequestErr(removeLocation(parseDecimal(&cmd[5])));
+    } else if (strncmp(cmd, "LOC ", 4) == 0) {
+        char* query = strchr(&cmd[4], ' ');
+        if (!query) {
+            reply("ERR query");
+            return;
+        }
+        *(query++) = '\0';
+        replyRequestErr(setLocation(parseDecimal(&cmd[4]), query));
+    } else if (strcmp(cmd, "REFRESH") == 0) {
+        requestRefresh();
+        reply("OK");
+    } else if (strcmp(cmd, "STATS") == 0) {
+        sendStats();
+        reply("OK");
+    } else if (strcmp(cmd, "PROFILE") == 0) {
+        sendProfile();
+        reply("OK");
+    } else if (strcmp(cmd, "PROFILE CLEAR") == 0) {
+        profileClear();
+        reply("OK");
+    } else if (strcmp(cmd, "TRACE") == 0) {
+        traceDump();
+        reply("OK");
+    } else if (strncmp(cmd, "ERR", 3) != 0) {
+        // Never answer an error with an error
+        reply("ERR command");
+    }
+}
+
+void controlProcess(void) {
+    int c;
+    while ((c = frameRead(CHANNEL_CONTROL)) >= 0) {
+        if (c != '\0') {
+            if (command_i < COMMAND_SIZE - 1) {
+                command[command_i++] = c;
+            } else {
+                commandOverflow = true;
+            }
+            continue;
+        }
+
+        command[command_i] = '\0';
+        if (commandOverflow) {
+            reply("ERR length");
+        } else {
+            execute(command);
+        }
+        command_i = 0;
+        commandOverflow = false;
+    }
+}
+
+void negotiateBaud(uint32_t baud) {
+    if (baud == uartStats.baud) return;
+
+    char message[16];
+    snprintf(message, sizeof(message), "BAUD %lu", (unsigned long)baud);
+    reply(message);
+    pendingBaud = baud;
+}
+
+inline bool baudPending(void) {
+    return pendingBaud != 0;
+}
+
+inline void cancelBaud(void) {
+    pendingBaud = 0;
+}
+
+void sendStats(void) {
+    char report[160];
+
+    snprintf(report, sizeof(report), "req sent=%lu ok=%lu timeout=%lu fail=%lu retry=%lu stale=%lu p50=%lu p90=%lu p99=%lu",
+            (unsigned long)requestStats.sent, (unsigned long)requestStats.completed,
+            (unsigned long)requestStats.timeouts, (unsigned long)requestStats.failures,
+            (unsigned long)requestStats.retries, (unsigned long)requestStats.stale,
+            (unsigned long)requestPercentile(50), (unsigned long)requestPercentile(90),
+            (unsigned long)requestPercentile(99));
+    sendReport(report);
+
+    snprintf(report, sizeof(report), "uart baud=%lu ppm=%ld overrun=%lu framing=%lu dropped=%lu pauses=%lu ring=%u",
+            (unsigned long)uartStats.baud, (long)uartStats.baudErrorPPM,
+            (unsigned long)uartStats.overruns, (unsigned long)uartStats.framingErrors,
+            (unsigned long)uartStats.dropped, (unsigned long)uartStats.pauses,
+            uartStats.ringHighWater);
+    sendReport(report);
+
+    snprintf(report, sizeof(report), "frame in=%lu out=%lu crc=%lu length=%lu channel=%lu full=%lu",
+            (unsigned long)frameStats.framesIn, (unsigned long)frameStats.framesOut,
+            (unsigned long)frameStats.crcErrors, (unsigned long)frameStats.lengthErrors,
+            (unsigned long)frameStats.channelErrors, (unsigned long)frameStats.queueFull);
+    sendReport(report);
+
+    snprintf(report, sizeof(report), "lcd depth=%u max=%u writes=%lu stalls=%lu latency=%lu worst=%lu frames=%lu frame=%u saved=%u total_saved=%lu",
+            lcdQueueDepth(), lcdStats.queueHighWater, (unsigned long)lcdStats.instructions,
+            (unsigned long)lcdStats.stalls, (unsigned long)lcdStats.lastLatency,
+            (unsigned long)lcdStats.maxLatency, (unsigned long)lcdStats.frames,
+            lcdStats.lastWrites, lcdStats.lastSaved, (unsigned long)lcdStats.totalSaved);
+    sendReport(report);
+
+    snprintf(report, sizeof(report), "glyph hits=%lu uploads=%lu evictions=%lu fallbacks=%lu",
+            (unsigned long)glyphStats.hits, (unsigned long)glyphStats.uploads,
+            (unsigned long)glyphStats.evictions, (unsigned long)glyphStats.fallbacks);
+    sendReport(report);
+
+    snprintf(report, sizeof(report), "notify published=%lu changes=%lu switches=%lu notifications=%lu early=%lu rollbacks=%lu",
+            (unsigned long)notifyStats.published, (unsigned long)notifyStats.changes,
+            (unsigned long)notifyStats.switches, (unsigned long)notifyStats.notifications,
+            (unsigned long)notifyStats.early, (unsigned long)notifyStats.rollbacks);
+    sendReport(report);
+
+    int i;
+    int length = snprintf(report, sizeof(report), "heap size=%u live=%lu peak=%lu allocs=%lu frees=%lu fail=%lu",
+            HEAP_SIZE, (unsigned long)heapTotal.live, (unsigned long)heapTotal.peak,
+            (unsigned long)heapTotal.allocations, (unsigned long)heapTotal.frees,
+            (unsigned long)heapTotal.failures);
+
+    // Live and peak bytes of every subsystem
+    for (i = 0; i < NUM_HEAP_SUBSYSTEMS && length < sizeof(report); i++) {
+        length += snprintf(&report[length], sizeof(report) - length, " %s=%lu/%lu",
+                heapName((HeapSubsystem)i), (unsigned long)heapStats[i].live,
+                (unsigned long)heapStats[i].peak);
+    }
+    sendReport(report);
+
+    snprintf(report, sizeof(report), "stack size=%lu used=%lu peak=%lu overflow=%d",
+            (unsigned long)stackSize(), (unsigned long)stackUsed(),
+            (unsigned long)stackHighWater(), stackOverflowed());
+    sendReport(report);
+
+    length = snprintf(report, sizeof(report), "clock state=%s switches=%lu fail=%lu",
+            clockName(clockState()), (unsigned long)clockStats.switches,
+            (unsigned long)clockStats.failures);
+
+    // Time spent in every state
+    for (i = 0; i < NUM_CLOCK_STATES && length < sizeof(report); i++) {
+        length += snprintf(&report[length], sizeof(report) - length, " %s=%lums",
+                clockName((ClockState)i), (unsigned long)(clockMicros((ClockState)i) / 1000));
+    }
+    sendReport(report);
+
+    length = snprintf(report, sizeof(report), "event sleeps=%lu asleep=%lums",
+            (unsigned long)eventSleep.sleeps, (unsigned long)(eventSleep.sleepMicros / 1000));
+
+    // Times handled, and average and worst wake latency in us, of every event
+    for (i = 0; i < NUM_EVENTS && length < sizeof(report); i++) {
+        length += snprintf(&report[length], sizeof(report) - length, " %s=%lu/%lu/%lu",
+                eventName((Event)i), (unsigned long)eventStats[i].handled,
+                (unsigned long)(eventStats[i].handled ? eventStats[i].totalLatency / eventStats[i].handled : 0),
+                (unsigned long)eventStats[i].maxLatency);
+    }
+    sendReport(report);
+
+    snprintf(report, sizeof(report),
+            "timer active=%u starts=%lu stops=%lu expired=%lu cascades=%lu wakes=%lu late=%lu",
+            timerStats.active, (unsigned long)timerStats.starts, (unsigned long)timerStats.stops,
+            (unsigned long)timerStats.expired, (unsigned long)timerStats.cascades,
+            (unsigned long)timerStats.wakes, (unsigned long)timerStats.maxLate);
+    sendReport(report);
+
+    // Runs, deadline misses, worst latency and worst and average run time in us of every task
+    for (i = 0; i < NUM_TASKS; i++) {
+        snprintf(report, sizeof(report), "task %s runs=%lu miss=%lu latency=%lu run=%lu avg=%lu",
+                taskName((Task)i), (unsigned long)taskStats[i].runs, (unsigned long)taskStats[i].misses,
+                (unsigned long)taskStats[i].maxLatency, (unsigned long)taskStats[i].maxRun,
+                (unsigned long)(taskStats[i].runs ? taskStats[i].totalRun / taskStats[i].runs : 0));
+        sendReport(report);
+    }
+}
+
+void sendProfile(void) {
+    char report[160];
+    int i;
+    int bucket;
+
+    // What the numbers below include for the profiler itself
+    snprintf(report, sizeof(report), "prof cost=%lu", (unsigned long)profileCost);
+    sendReport(report);
+
+    for (i = 0; i < NUM_PROFILE_SCOPES; i++) {
+        const ProfileStats* stats = &profileStats[i];
+        uint32_t count = profileCount((ProfileScope)i);
+        if (count == 0) continue;
+
+        int length = snprintf(report, sizeof(report), "prof %s n=%lu min=%lu max=%lu avg=%lu hist",
+                profileName((ProfileScope)i), (unsigned long)count, (unsigned long)stats->min,
+                (unsigned long)stats->max, (unsigned long)(stats->total / count));
+
+        // Histogram as log2 bucket:count, skipping empty buckets
+        for (bucket = 0; bucket < PROFILE_BUCKETS && length < sizeof(report); bucket++) {
+            if (stats->histogram[bucket] == 0) continue;
+            length += snprintf(&report[length], sizeof(report) - length, " %d:%lu",
+                    bucket, (unsigned long)stats->histogram[bucket]);
+        }
+        sendReport(report);
+    }
+}
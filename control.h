@@ -0,0 +1,74 @@
+/*
+ * control.h
+ *
+ *      Description: Command handler for the control channel. Commands and
+ *                   replies are NUL-terminated text:
+ *
+ *                   LOC <slot> <query>  Replace the location in a slot
+ *                   LOC+ <query>        Add a location
+ *                   LOC- <slot>         Remove a location
+ *                   REFRESH             Send a request now
+ *                   STATS               Report link statistics on the
+ *                                       telemetry channel
+ *                   PROFILE             Report profiled scopes on the
+ *                                       telemetry channel
+ *                   PROFILE CLEAR       Clear profiled scopes
+ *                   TRACE               Dump the trace ring on the
+ *                                       telemetry channel, see trace.h
+ *
+ *                   Each command is answered with "OK" or "ERR <reason>".
+ *                   The device also sends "BAUD <rate>" to ask the forwarder
+ *                   for a new link rate, which the forwarder accepts with
+ *                   "BAUD OK". A plain "OK" never changes the rate.
+ *
+ *      Author: gibbonec
+ */
+
+#ifndef CONTROL_H_
+#define CONTROL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define COMMAND_SIZE 48
+#define NEGOTIATE_TIMEOUT 250 // Time to wait for the forwarder to accept a new rate in ms
+
+/*
+ * Reads and executes any complete commands from the control channel.
+ */
+void controlProcess(void);
+
+/*
+ * Asks the forwarder to switch the link to the given baud rate. The rate is
+ *  changed once the forwarder answers "BAUD OK"; until then baudPending is true.
+ */
+void negotiateBaud(uint32_t baud);
+
+bool baudPending(void);
+
+/*
+ * Gives up on the rate asked for, so a late "BAUD OK" leaves the rate alone.
+ */
+void cancelBaud(void);
+
+/*
+ * Sends a snapshot of the request, UART, framing, LCD, glyph and notification
+ *  statistics on the telemetry channel.
+ */
+void sendStats(void);
+
+/*
+ * Sends the count, min, max and average cycles and the log2 histogram of every
+ *  profiled scope that has run on the telemetry channel.
+ */
+void sendProfile(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CONTROL_H_ */
@@ -50,9 +50,16 @@ void configHFXT(void)
      */
     FLCTL_A->BANK0_RDCTL = (FLCTL_A->BANK0_RDCTL & ~(FLCTL_A_BANK0_RDCTL_WAIT_MASK)) |
             FLCTL_A_BANK0_RDCTL_WAIT_3;
-    FLCTL_A->BANK1_RDCTL  = (FLCTL_A->BANK0_RDCTL & ~(FLCTL_A_BANK1_RDCTL_WAIT_MASK)) |
+    FLCTL_A->BANK1_RDCTL  = (FLCTL_A->BANK1_RDCTL & ~(FLCTL_A_BANK1_RDCTL_WAIT_MASK)) |
             FLCTL_A_BANK1_RDCTL_WAIT_3;
 
+    /* Enable the instruction and data read buffers of both banks, so code
+     *   left in flash (see ramfunc.h) mostly hits a buffer rather than
+     *   waiting out all 3 wait states
+     */
+    FLCTL_A->BANK0_RDCTL |= FLCTL_A_BANK0_RDCTL_BUFI | FLCTL_A_BANK0_RDCTL_BUFD;
+    FLCTL_A->BANK1_RDCTL |= FLCTL_A_BANK1_RDCTL_BUFI | FLCTL_A_BANK1_RDCTL_BUFD;
+
     /* Step 3: Configure HFXT to use 48MHz crystal, source to MCLK & HSMCLK */
 
 
@@ -0,0 +1,277 @@
+#include "display.h"
+#include "format.h"
+#include "glyph.h"
+#include "condition.h"
+#include "profile.h"
+#include "trace.h"
+#include "event.h"
+#include "timer.h"
+#include <string.h>
+
+// One line of text per field, rendered from the last response
+char pages[NUM_FIELDS][LCD_COLUMNS + 1];
+bool pagesValid = false;
+
+// Full text of fields too long for a line, and its length, or 0 if it fits
+char longPages[NUM_FIELDS][LCD_LINE_LENGTH];
+int longLengths[NUM_FIELDS];
+
+// Marquee scrolling the long page shown on one of the lines
+int marqueeLine = -1;       // Line scrolling, or -1 for none
+LCDField marqueeField;      // Field shown on that line
+int marqueeSteps = 0;       // Shifts that bring the end of the text into view
+int marqueeTicks = 0;       // Ticks into the current scroll
+bool marqueeDue = false;
+
+void marqueeTick(Timer* timer);
+Timer marqueeTimer = TIMER(marqueeTick);
+
+// Fields that need rendering again, as LCDField bits
+uint32_t dirtyFields = 0;
+
+typedef bool (*FieldFormatter)(FormatLine* line, const Reading* value, int width, int decimals);
+
+typedef struct {
+    const char* label;
+    Topic topic;
+    FieldFormatter format;
+    int width;
+    int decimals;
+    const char* unit;
+    Topic detail;
+    FieldFormatter formatDetail;
+    int detailWidth;
+} FieldLayout;
+
+bool renderNumber(FormatLine* line, const Reading* value, int width, int decimals) {
+    if (!value->hasNumber) return false;
+    formatFloat(line, value->number, decimals, width);
+    return true;
+}
+
+bool renderText(FormatLine* line, const Reading* value, int width, int decimals) {
+    if (!value->hasText) return false;
+    formatText(line, value->text, strlen(value->text), width);
+    return true;
+}
+
+// Icon and abbreviation for a condition code, falling back on its text for unknown codes
+bool renderCondition(FormatLine* line, const Reading* value, int width, int decimals) {
+    const Condition* condition = value->hasNumber ? conditionLookup((int)value->number) : NULL;
+
+    if (condition) {
+        formatChar(line, glyphChar(condition->glyph));
+        formatChar(line, ' ');
+        formatText(line, condition->abbreviation, strlen(condition->abbreviation), width - 2);
+        return true;
+    }
+
+    return renderText(line, value, width, decimals);
+}
+
+// Arrow pointing the way the wind blows, from a compass point such as "SSW"
+bool renderArrow(FormatLine* line, const Reading* value, int width, int decimals) {
+    int length = strlen(value->text);
+    if (!value->hasText || length == 0) return false;
+
+    // Sum unit vectors of each letter, weighting the first letter double as in "NNE"
+    int north = 0;
+    int east = 0;
+    int i;
+    for (i = 0; i < length; i++) {
+        int weight = (i == 0 && length == 3) ? 2 : 1;
+        switch (value->text[i]) {
+        case 'N':
+            north += weight;
+            break;
+        case 'S':
+            north -= weight;
+            break;
+        case 'E':
+            east += weight;
+            break;
+        case 'W':
+            east -= weight;
+            break;
+        default:
+            return false;
+        }
+    }
+
+    // Wind is named for where it comes from, so the arrow points the other way
+    Glyph arrow;
+    if (north < 0 && east == 0) arrow = GLYPH_ARROW_N;
+    else if (north == 0 && east < 0) arrow = GLYPH_ARROW_E;
+    else if (north > 0 && east == 0) arrow = GLYPH_ARROW_S;
+    else if (north == 0 && east > 0) arrow = GLYPH_ARROW_W;
+    else if (north < 0) arrow = east < 0 ? GLYPH_ARROW_NE : GLYPH_ARROW_NW;
+    else arrow = east < 0 ? GLYPH_ARROW_SE : GLYPH_ARROW_SW;
+
+    formatChar(line, glyphChar(arrow));
+    formatText(line, "", 0, width - 1);
+    return true;
+}
+
+// Appends a layout string, replacing embedded glyphs such as SYMBOL_DEGREE
+void formatSymbols(FormatLine* line, const char* str) {
+    for (; *str != '\0'; str++) {
+        formatChar(line, (unsigned char)*str < GLYPH_SYMBOLS ? glyphChar((Glyph)*str) : *str);
+    }
+}
+
+#define LAYOUT_ENTRY(field, label, topic, formatter, width, decimals, unit, detail, detailFormatter, detailWidth) \
+    {label, topic, formatter, width, decimals, unit, detail, detailFormatter, detailWidth},
+
+const FieldLayout layout[NUM_FIELDS] = {
+    LAYOUT(LAYOUT_ENTRY)
+};
+
+// Every row must fit on a line, with decimals the formatter supports
+#define LAYOUT_CHECK(field, label, topic, formatter, width, decimals, unit, detail, detailFormatter, detailWidth) \
+    FORMAT_CHECK(field, label, (width) + (detailWidth), decimals, unit);
+
+LAYOUT(LAYOUT_CHECK)
+STATIC_ASSERT(FORMAT_COLUMNS == LCD_COLUMNS, line_width);
+STATIC_ASSERT(FORMAT_LINE_LENGTH == LCD_LINE_LENGTH, line_length);
+STATIC_ASSERT(NUM_FIELDS >= 2, fields_for_both_lines);
+STATIC_ASSERT(NUM_FIELDS <= 32, fields_fit_dirty_bits);
+
+void renderField(LCDField field) {
+    const FieldLayout* row = &layout[field];
+    FormatLine line;
+
+    formatBegin(&line);
+    formatSymbols(&line, row->label);
+    if (!row->format(&line, currentReading(row->topic), row->width, row->decimals)) return;
+    formatSymbols(&line, row->unit);
+    if (row->detail != TOPIC_NONE && !row->formatDetail(&line, currentReading(row->detail), row->detailWidth, 0)) return;
+
+    // Keep the whole line too, if it was cut off, for the marquee
+    int length = line.length < LCD_COLUMNS ? line.length : LCD_COLUMNS;
+    memcpy(pages[field], line.text, length);
+    pages[field][length] = '\0';
+
+    longLengths[field] = line.length > LCD_COLUMNS ? line.length : 0;
+    memcpy(longPages[field], line.text, longLengths[field]);
+}
+
+// Marks the pages showing a reading that changed
+void readingChanged(Topic topic, const Reading* old, const Reading* now) {
+    LCDField field;
+    for (field = (LCDField)0; field < NUM_FIELDS; field++) {
+        if (layout[field].topic == topic || layout[field].detail == topic) {
+            dirtyFields |= 1ul << field;
+        }
+    }
+}
+
+void configDisplay(void) {
+    uint32_t topics = 0;
+    LCDField field;
+    for (field = (LCDField)0; field < NUM_FIELDS; field++) {
+        topics |= TOPIC_BIT(layout[field].topic) | TOPIC_BIT(layout[field].detail);
+    }
+    subscribe(topics, readingChanged);
+
+    // Nothing has been rendered yet
+    dirtyFields = (1ul << NUM_FIELDS) - 1;
+}
+
+bool renderPages(void) {
+    if (!dirtyFields) return false;
+    PROFILE_BEGIN(PROFILE_RENDER);
+
+    bool shown = dirtyFields & ((1ul << field1) | (1ul << field2));
+    uint32_t evictions = glyphStats.evictions;
+    LCDField field;
+    TRACE(TRACE_RENDER, dirtyFields, shown);
+
+    glyphFrame();
+    for (field = (LCDField)0; field < NUM_FIELDS; field++) {
+        if (dirtyFields & (1ul << field)) renderField(field);
+    }
+
+    // An evicted glyph may have belonged to a page that wasn't rendered, so
+    //  render them all in this frame to pin every glyph in use
+    if (glyphStats.evictions != evictions) {
+        for (field = (LCDField)0; field < NUM_FIELDS; field++) {
+            renderField(field);
+        }
+        shown = true;
+    }
+
+    dirtyFields = 0;
+    pagesValid = true;
+
+    PROFILE_END(PROFILE_RENDER);
+    return shown;
+}
+
+void showPages(void) {
+    if (!pagesValid) return;
+    PROFILE_BEGIN(PROFILE_SHOW);
+
+    // The display shift moves both lines, so only one can scroll
+    int line = longLengths[field1] ? 0 : longLengths[field2] ? 1 : -1;
+    LCDField field = line == 0 ? field1 : field2;
+    if (line != marqueeLine || (line >= 0 && field != marqueeField)) {
+        marqueeLine = line;
+        marqueeField = field;
+        marqueeTicks = 0;
+        unshiftDisplay();
+
+        // Only tick while a line scrolls
+        if (line >= 0) {
+            timerStart(&marqueeTimer, MARQUEE_PERIOD, MARQUEE_PERIOD);
+        } else {
+            timerStop(&marqueeTimer);
+        }
+    }
+
+    if (marqueeLine >= 0) {
+        marqueeSteps = longLengths[marqueeField] - LCD_COLUMNS;
+        if (displayShift() > marqueeSteps) {
+            marqueeTicks = 0;
+            unshiftDisplay();
+        }
+    }
+
+    if (marqueeLine == 0) {
+        writeLongLine(0, longPages[field1], longLengths[field1]);
+    } else {
+        writeLine(0, pages[field1]);    // Top line
+    }
+    if (marqueeLine == 1) {
+        writeLongLine(1, longPages[field2], longLengths[field2]);
+    } else {
+        writeLine(1, pages[field2]);    // Bottom line
+    }
+    refreshLCD();                       // Write only the cells that changed
+
+    PROFILE_END(PROFILE_SHOW);
+}
+
+void marqueeProcess(void) {
+    if (!marqueeDue) return;
+    marqueeDue = false;
+    if (marqueeLine < 0) return;
+
+    // Dwell at the start, shift one column a tick until the end of the text is
+    //  in view, dwell again, then jump back to the start
+    marqueeTicks++;
+    if (marqueeTicks <= MARQUEE_DWELL) return;
+
+    if (displayShift() < marqueeSteps) {
+        shiftDisplayLeft();
+    } else if (marqueeTicks > 2 * MARQUEE_DWELL + marqueeSteps) {
+        unshiftDisplay();
+        marqueeTicks = 0;
+    }
+}
+
+// Marquee tick, stepped by the render task
+void marqueeTick(Timer* timer) {
+    marqueeDue = true;
+    eventPost(EVENT_MARQUEE);
+    TRACE(TRACE_MARQUEE, 0, 0);
+}
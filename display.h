@@ -0,0 +1,60 @@
+/*
+ * display.h
+ *
+ *      Description: Page cache for the LCD. Every field is rendered to a line
+ *                   of text once, when one of its readings changes, so cycling
+ *                   fields with the button only copies cached lines to the
+ *                   display.
+ *
+ *                   Text too long for a line is written whole to the 40 column
+ *                   DDRAM line and scrolled into view with the HD44780 display
+ *                   shift, one instruction per step, from a software timer
+ *                   that only runs while a line scrolls. The display shift
+ *                   moves both lines together, so the other line scrolls
+ *                   along with the marquee and only one line at a time can
+ *                   scroll.
+ *
+ *      Author: gibbonec
+ */
+
+#ifndef DISPLAY_H_
+#define DISPLAY_H_
+
+#include "lcd.h"
+#include "notify.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MARQUEE_PERIOD 300  // Time between marquee steps in ms
+#define MARQUEE_DWELL 5     // Steps to pause at either end of the text
+
+/*
+ * Subscribes the page cache to the readings the layout shows.
+ */
+void configDisplay(void);
+
+/*
+ * Renders the fields whose readings changed since the last call into the page
+ *  cache. A field that can't be rendered keeps its previous text. Returns true
+ *  if a page on the LCD changed and should be shown.
+ */
+bool renderPages(void);
+
+/*
+ * Shows the cached pages for field1 and field2 on the LCD. Does nothing until
+ *  pages have been rendered.
+ */
+void showPages(void);
+
+/*
+ * Steps the marquee if a tick has passed since the last call.
+ */
+void marqueeProcess(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DISPLAY_H_ */
@@ -0,0 +1,104 @@
+#include "msp.h"
+#include "event.h"
+#include "timebase.h"
+
+#define EVENT_NAME(event, name) name,
+
+const char* const eventNames[NUM_EVENTS] = {
+    EVENTS(EVENT_NAME)
+};
+
+EventStats eventStats[NUM_EVENTS];
+EventSleep eventSleep;
+
+volatile EventSet eventPending = 0;
+uint64_t eventPosted[NUM_EVENTS];   // Cycle count each pending event was first posted at
+
+void initEvents(void) {
+    // Sleep is LPM0, not deep sleep
+    SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+}
+
+// Marks an event pending, with interrupts masked
+void markEvent(Event event) {
+    if (!(eventPending & EVENT_BIT(event))) {
+        eventPending |= EVENT_BIT(event);
+        eventPosted[event] = nowCycles();
+    }
+    eventStats[event].posts++;
+}
+
+// Takes every pending event, with interrupts masked
+EventSet takeEvents(void) {
+    EventSet events = eventPending;
+    uint64_t now = nowCycles();
+    int i;
+
+    eventPending = 0;
+    for (i = 0; i < NUM_EVENTS; i++) {
+        if (!(events & EVENT_BIT(i))) continue;
+
+        uint32_t latency = (now - eventPosted[i]) / cyclesPerMicrosecond();
+        eventStats[i].handled++;
+        eventStats[i].totalLatency += latency;
+        if (latency > eventStats[i].maxLatency) eventStats[i].maxLatency = latency;
+    }
+    return events;
+}
+
+void eventPost(Event event) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    markEvent(event);
+    __set_PRIMASK(primask);
+
+    // Return to the main loop rather than to sleep
+    SCB->SCR &= ~SCB_SCR_SLEEPONEXIT_Msk;
+}
+
+EventSet eventWait(void) {
+    __disable_irq();
+
+    if (!eventPending) {
+        uint64_t start = nowCycles();
+
+        // Sleep with interrupts masked so none is taken between the check and
+        //  WFI. A pending one still wakes the core and is taken once they're
+        //  unmasked. Handlers then return to sleep until one posts an event
+        SCB->SCR |= SCB_SCR_SLEEPONEXIT_Msk;
+        while (!eventPending) {
+            __WFI();
+            __enable_irq();
+            __disable_irq();
+        }
+        SCB->SCR &= ~SCB_SCR_SLEEPONEXIT_Msk;
+
+        eventSleep.sleeps++;
+        eventSleep.sleepMicros += (nowCycles() - start) / cyclesPerMicrosecond();
+    }
+
+    EventSet events = takeEvents();
+    __enable_irq();
+    return events;
+}
+
+EventSet eventPoll(void) {
+    __disable_irq();
+    EventSet events = takeEvents();
+    __enable_irq();
+    return events;
+}
+
+inline const char* eventName(Event event) {
+    return eventNames[event];
+}
+
+void testEvents(void) {
+    // A pending event returns at once, without sleeping
+    uint32_t sleeps = eventSleep.sleeps;
+    eventPost(EVENT_WORK);
+    eventPost(EVENT_WORK);
+    EventSet events = eventWait();                  // Should be EVENT_BIT(EVENT_WORK)
+    bool slept = eventSleep.sleeps != sleeps;       // Should be false
+    uint32_t merged = eventStats[EVENT_WORK].posts - eventStats[EVENT_WORK].handled;  // Should be 1
+}
@@ -0,0 +1,96 @@
+/*
+ * event.h
+ *
+ *      Description: Events that wake the main loop. Interrupt handlers post
+ *                   them, and the main loop sleeps in LPM0 whenever none are
+ *                   pending:
+ *
+ *                   X(event, name)
+ *
+ *                   The loop waits with SLEEPONEXIT set, so a handler that
+ *                   posts nothing returns straight to sleep without running
+ *                   the loop. Posting clears it. Each event is a bit, so
+ *                   posting one that is already pending only counts it.
+ *
+ *                   LPM3 would stop SMCLK, which the UART and LCD timer run
+ *                   from, so the loop never sleeps deeper than LPM0.
+ *
+ *                   Events, tasks and timers only build for the device.
+ *                   There's no host build that runs the scheduler yet.
+ *
+ *      Author: gibbonec
+ */
+
+#ifndef EVENT_H_
+#define EVENT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define EVENTS(X) \
+    X(EVENT_UART,    "uart") \
+    X(EVENT_TIMER,   "timer") \
+    X(EVENT_MARQUEE, "marquee") \
+    X(EVENT_BUTTON,  "button") \
+    X(EVENT_WORK,    "work")
+
+#define EVENT_ENUM(event, name) event,
+
+typedef enum {
+    EVENTS(EVENT_ENUM)
+    NUM_EVENTS,
+} Event;
+
+#define EVENT_BIT(event) (1u << (event))
+
+typedef uint32_t EventSet;
+
+typedef struct {
+    uint32_t posts;
+    uint32_t handled;       // Times the loop took it, fewer than posts if it was still pending
+    uint32_t maxLatency;    // Most microseconds from post to the loop taking it
+    uint64_t totalLatency;
+} EventStats;
+
+typedef struct {
+    uint32_t sleeps;
+    uint64_t sleepMicros;   // Time the loop spent waiting, including the handlers run meanwhile
+} EventSleep;
+
+extern EventStats eventStats[NUM_EVENTS];
+extern EventSleep eventSleep;
+
+/*
+ * Selects LPM0 for the sleep in eventWait.
+ */
+void initEvents(void);
+
+/*
+ * Marks an event pending and wakes the main loop. Safe from any context.
+ */
+void eventPost(Event event);
+
+/*
+ * Sleeps until an event is pending, then returns and clears every pending
+ *  event.
+ */
+EventSet eventWait(void);
+
+/*
+ * Returns and clears every pending event without sleeping, 0 if there are none.
+ */
+EventSet eventPoll(void);
+
+const char* eventName(Event event);
+
+void testEvents(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EVENT_H_ */
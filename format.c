@@ -0,0 +1,130 @@
+#include "format.h"
+#include <msp.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+const int32_t powers[FORMAT_MAX_DECIMALS + 1] = {1, 10, 100, 1000, 10000};
+
+// Drops anything past the end of the line
+inline void formatChar(FormatLine* line, char c) {
+    if (line->length < FORMAT_LINE_LENGTH) {
+        line->text[line->length++] = c;
+        line->text[line->length] = '\0';
+    }
+}
+
+inline void formatBegin(FormatLine* line) {
+    line->length = 0;
+    line->text[0] = '\0';
+}
+
+void formatText(FormatLine* line, const char* str, size_t length, int width) {
+    int i;
+    for (i = 0; i < length; i++) {
+        formatChar(line, str[i]);
+    }
+    for (; i < width; i++) {
+        formatChar(line, ' ');
+    }
+}
+
+inline void formatString(FormatLine* line, const char* str) {
+    formatText(line, str, strlen(str), 0);
+}
+
+// Appends a magnitude with its sign, so a value that rounds to 0 can still show as negative
+void formatSigned(FormatLine* line, uint32_t magnitude, bool negative, int decimals, int width) {
+    // Digits are generated backwards, least significant first
+    char digits[12];
+    int count = 0;
+
+    do {
+        digits[count++] = '0' + magnitude % 10;
+        magnitude /= 10;
+        // Leading zero before the decimal point, as in "0.5"
+    } while (magnitude > 0 || count <= decimals);
+
+    int length = count + (decimals > 0) + negative;
+    for (; length < width; length++) {
+        formatChar(line, ' ');
+    }
+
+    if (negative) formatChar(line, '-');
+    while (count > 0) {
+        if (count == decimals) formatChar(line, '.');
+        formatChar(line, digits[--count]);
+    }
+}
+
+inline void formatFixed(FormatLine* line, int32_t value, int decimals, int width) {
+    formatSigned(line, value < 0 ? -(uint32_t)value : value, value < 0, decimals, width);
+}
+
+void formatFloat(FormatLine* line, float value, int decimals, int width) {
+    int32_t fixed = toFixed(value, decimals);
+
+    // Like printf, keep the sign of a value that rounds to 0
+    formatSigned(line, fixed < 0 ? -(uint32_t)fixed : fixed, signbit(value), decimals, width);
+}
+
+int32_t toFixed(float value, int decimals) {
+    float scaled = value * powers[decimals];
+    if (scaled >= 2147483647.0f) return INT32_MAX;
+    if (scaled <= -2147483648.0f) return INT32_MIN;
+    return (int32_t)(scaled < 0 ? scaled - 0.5f : scaled + 0.5f);
+}
+
+// Cycles taken by a call, from the DWT cycle counter
+#define CYCLES(call) (start = DWT->CYCCNT, (call), DWT->CYCCNT - start)
+
+void testFormat(void) {
+    FormatLine line;
+    uint32_t start;
+
+    // Should match "Temp:   44.400 F", "Humidity: 58.00%", "Wind: 23.0 mph S", "Temp:   -0.500 F" and "Temp:   -0.000 F"
+    formatBegin(&line);
+    formatString(&line, "Temp: ");
+    formatFixed(&line, toFixed(44.4f, 3), 3, 8);
+    formatString(&line, " F");
+
+    formatBegin(&line);
+    formatString(&line, "Humidity: ");
+    formatFixed(&line, toFixed(58, 2), 2, 5);
+    formatString(&line, "%");
+
+    formatBegin(&line);
+    formatString(&line, "Wind: ");
+    formatFixed(&line, toFixed(23.0f, 1), 1, 3);
+    formatString(&line, " mph ");
+    formatText(&line, "S", 1, 2);
+
+    formatBegin(&line);
+    formatString(&line, "Temp: ");
+    formatFixed(&line, toFixed(-0.5f, 3), 3, 8);
+    formatString(&line, " F");
+
+    formatBegin(&line);
+    formatString(&line, "Temp: ");
+    formatFloat(&line, -0.0004f, 3, 8);
+    formatString(&line, " F");
+
+    // Should truncate to "Wind: 1234567.0 mph Patchy light rain wi" without overrunning
+    formatBegin(&line);
+    formatString(&line, "Wind: ");
+    formatFixed(&line, toFixed(1234567.0f, 1), 1, 3);
+    formatString(&line, " mph ");
+    formatString(&line, "Patchy light rain with thunder");
+
+    // Benchmark against snprintf. Check the cycle counts here
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    #ifdef FORMAT_PRINTF_FLOAT
+    char buffer[FORMAT_COLUMNS + 1];
+    uint32_t snprintfCycles = CYCLES(snprintf(buffer, sizeof(buffer), "Temp: %8.3f F", 44.4f));
+    #endif
+    uint32_t formatCycles = CYCLES((formatBegin(&line), formatString(&line, "Temp: "),
+            formatFloat(&line, 44.4f, 3, 8), formatString(&line, " F")));
+}
@@ -0,0 +1,95 @@
+/*
+ * format.h
+ *
+ *      Description: Small formatter for display lines, in place of snprintf.
+ *                   Numbers are formatted from scaled integers with a fixed
+ *                   number of decimals, right aligned and padded to a minimum
+ *                   width like "%*.*f". Lines hold up to FORMAT_LINE_LENGTH
+ *                   characters, so text that runs past FORMAT_COLUMNS is kept
+ *                   for scrolling, and anything beyond is truncated.
+ *
+ *                   The build links printf without float support
+ *                   (--printf_support=nofloat), so nothing may pass a float
+ *                   to a printf. Define FORMAT_PRINTF_FLOAT, and build with
+ *                   the full printf, for testFormat to benchmark %f.
+ *
+ *                   Formats that are constant can be checked at compile time
+ *                   with FORMAT_CHECK, which fails the build if a format can't
+ *                   fit on a line.
+ *
+ *      Author: gibbonec
+ */
+
+#ifndef FORMAT_H_
+#define FORMAT_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FORMAT_COLUMNS 16
+#define FORMAT_LINE_LENGTH 40
+#define FORMAT_MAX_DECIMALS 4
+
+// Fails the build if cond is false, naming the failure after name
+#define STATIC_ASSERT(cond, name) typedef char static_assert_##name[(cond) ? 1 : -1]
+
+// Checks a "<prefix><number><suffix>" format fits on a line and its decimals are supported
+#define FORMAT_CHECK(name, prefix, width, decimals, suffix) \
+    STATIC_ASSERT(sizeof(prefix) - 1 + (width) + sizeof(suffix) - 1 <= FORMAT_COLUMNS, name##_fits); \
+    STATIC_ASSERT((decimals) <= FORMAT_MAX_DECIMALS && (width) > (decimals), name##_decimals)
+
+typedef struct {
+    char text[FORMAT_LINE_LENGTH + 1];
+    int length;
+} FormatLine;
+
+/*
+ * Empties a line.
+ */
+void formatBegin(FormatLine* line);
+
+/*
+ * Appends a character.
+ */
+void formatChar(FormatLine* line, char c);
+
+/*
+ * Appends a string of the given length, left aligned and padded with spaces
+ *  to at least width characters.
+ */
+void formatText(FormatLine* line, const char* str, size_t length, int width);
+
+/*
+ * Appends a NUL-terminated string.
+ */
+void formatString(FormatLine* line, const char* str);
+
+/*
+ * Appends value / 10^decimals with exactly that many decimals, right aligned
+ *  and padded with spaces to at least width characters.
+ */
+void formatFixed(FormatLine* line, int32_t value, int decimals, int width);
+
+/*
+ * Appends a float rounded to the given decimals like "%*.*f", including the
+ *  sign of a negative value that rounds to 0, as in "-0.000".
+ */
+void formatFloat(FormatLine* line, float value, int decimals, int width);
+
+/*
+ * Scales a value by 10^decimals and rounds it to the nearest integer,
+ *  saturating at the limits of int32_t.
+ */
+int32_t toFixed(float value, int decimals);
+
+void testFormat(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FORMAT_H_ */
@@ -0,0 +1,280 @@
+#include "frame.h"
+#include "uart.h"
+#include "task.h"
+
+#define HEADER_SIZE 2
+#define CRC_SIZE 2
+
+// Byte ring for a single direction of a channel. Size must be a power of 2 of
+// at least FRAME_MAX_PAYLOAD, or 0 for a channel the device never reads
+typedef struct {
+    uint8_t* data;
+    unsigned int size;
+    unsigned int head;
+    unsigned int tail;
+} Queue;
+
+FrameStats frameStats;
+
+uint8_t httpTx[512];
+uint8_t httpRx[128];
+uint8_t controlTx[64];
+uint8_t controlRx[64];
+uint8_t telemetryTx[512];
+
+Queue txQueues[NUM_CHANNELS] = {
+    {httpTx, sizeof(httpTx)},
+    {controlTx, sizeof(controlTx)},
+    {telemetryTx, sizeof(telemetryTx)},
+};
+
+Queue rxQueues[NUM_CHANNELS] = {
+    {httpRx, sizeof(httpRx)},
+    {controlRx, sizeof(controlRx)},
+    {NULL, 0}, // Telemetry only flows from the device
+};
+
+// Channels in transmit priority order
+const Channel txOrder[NUM_CHANNELS] = {CHANNEL_CONTROL, CHANNEL_TELEMETRY, CHANNEL_HTTP};
+
+// Decoder state for the frame being received
+uint8_t inFrame[HEADER_SIZE + FRAME_MAX_PAYLOAD + CRC_SIZE];
+int inLen = 0;
+bool inEscaped = false;
+bool inOverflow = false;
+bool inReady = false;   // A valid frame is waiting for room in its channel
+
+inline unsigned int queueCount(const Queue* queue) {
+    return queue->head - queue->tail;
+}
+
+inline unsigned int queueSpace(const Queue* queue) {
+    return queue->size - queueCount(queue);
+}
+
+inline void queuePush(Queue* queue, uint8_t c) {
+    queue->data[queue->head++ & (queue->size - 1)] = c;
+}
+
+inline uint8_t queuePop(Queue* queue) {
+    return queue->data[queue->tail++ & (queue->size - 1)];
+}
+
+uint16_t crc16(uint16_t crc, const uint8_t* data, size_t length) {
+    while (length--) {
+        crc ^= *(data++) << 8;
+        int i;
+        for (i = 0; i < 8; i++) {
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+bool frameSend(Channel channel, const void* data, size_t length) {
+    Queue* queue = &txQueues[channel];
+    if (queueSpace(queue) < length) {
+        frameStats.queueFull++;
+        return false;
+    }
+
+    const uint8_t* bytes = data;
+    while (length--) {
+        queuePush(queue, *(bytes++));
+    }
+
+    // Only the link task transmits, so wake it wherever the payload came from
+    taskPost(TASK_LINK);
+    return true;
+}
+
+int frameRead(Channel channel) {
+    Queue* queue = &rxQueues[channel];
+    if (queueCount(queue) == 0) return -1;
+    return queuePop(queue);
+}
+
+void frameFlush(Channel channel) {
+    rxQueues[channel].tail = rxQueues[channel].head;
+}
+
+// Moves the decoded frame into its channel if there's room
+bool deliverFrame(void) {
+    Queue* queue = &rxQueues[inFrame[0]];
+    int length = inFrame[1];
+    if (queueSpace(queue) < length) return false;
+
+    int i;
+    for (i = 0; i < length; i++) {
+        queuePush(queue, inFrame[HEADER_SIZE + i]);
+    }
+
+    frameStats.framesIn++;
+    inReady = false;
+    inLen = 0;
+    return true;
+}
+
+// Validates a frame once its FRAME_END has been received
+void finishFrame(void) {
+    bool valid = false;
+
+    if (inOverflow || inLen < HEADER_SIZE + CRC_SIZE || inLen != HEADER_SIZE + inFrame[1] + CRC_SIZE) {
+        frameStats.lengthErrors++;
+    } else if (crc16(0xFFFF, inFrame, inLen - CRC_SIZE) != ((inFrame[inLen - 2] << 8) | inFrame[inLen - 1])) {
+        frameStats.crcErrors++;
+    } else if (inFrame[0] >= NUM_CHANNELS || rxQueues[inFrame[0]].size == 0) {
+        frameStats.channelErrors++;
+    } else {
+        valid = true;
+    }
+
+    inOverflow = false;
+    inEscaped = false;
+    if (valid) {
+        inReady = true;
+    } else {
+        inLen = 0;
+    }
+}
+
+// Runs a single received byte through the SLIP decoder
+void decodeByte(uint8_t c) {
+    if (c == FRAME_END) {
+        // Back to back FRAME_ENDs are just idle
+        if (inLen > 0 || inOverflow) finishFrame();
+        return;
+    }
+
+    if (inEscaped) {
+        inEscaped = false;
+        switch (c) {
+        case FRAME_ESC_END:
+            c = FRAME_END;
+            break;
+        case FRAME_ESC_ESC:
+            c = FRAME_ESC;
+            break;
+        case FRAME_ESC_XON:
+            c = XON;
+            break;
+        case FRAME_ESC_XOFF:
+            c = XOFF;
+            break;
+        }
+    } else if (c == FRAME_ESC) {
+        inEscaped = true;
+        return;
+    }
+
+    if (inLen < sizeof(inFrame)) {
+        inFrame[inLen++] = c;
+    } else {
+        inOverflow = true;
+    }
+}
+
+// Writes a byte of a frame, escaping anything with a special meaning on the link
+void writeEscaped(uint8_t c) {
+    switch (c) {
+    case FRAME_END:
+        uartWrite(FRAME_ESC);
+        uartWrite(FRAME_ESC_END);
+        break;
+    case FRAME_ESC:
+        uartWrite(FRAME_ESC);
+        uartWrite(FRAME_ESC_ESC);
+        break;
+    case XON:
+        uartWrite(FRAME_ESC);
+        uartWrite(FRAME_ESC_XON);
+        break;
+    case XOFF:
+        uartWrite(FRAME_ESC);
+        uartWrite(FRAME_ESC_XOFF);
+        break;
+    default:
+        uartWrite(c);
+    }
+}
+
+// Sends up to FRAME_MAX_PAYLOAD bytes from the channel's queue as one frame
+void transmitFrame(Channel channel) {
+    Queue* queue = &txQueues[channel];
+    unsigned int length = queueCount(queue);
+    if (length > FRAME_MAX_PAYLOAD) length = FRAME_MAX_PAYLOAD;
+
+    uint8_t header[HEADER_SIZE] = {channel, length};
+    uint16_t crc = crc16(0xFFFF, header, HEADER_SIZE);
+
+    // Leading FRAME_END flushes any line noise out of the receiver
+    uartWrite(FRAME_END);
+    writeEscaped(header[0]);
+    writeEscaped(header[1]);
+
+    while (length--) {
+        uint8_t c = queuePop(queue);
+        crc = crc16(crc, &c, 1);
+        writeEscaped(c);
+    }
+
+    writeEscaped(crc >> 8);
+    writeEscaped(crc & 0xFF);
+    uartWrite(FRAME_END);
+
+    frameStats.framesOut++;
+}
+
+void frameProcess(void) {
+    // Receive until the UART ring is empty or a channel is full
+    while (!inReady || deliverFrame()) {
+        int c = uartRead();
+        if (c < 0) break;
+        decodeByte(c);
+    }
+
+    int i;
+    for (i = 0; i < NUM_CHANNELS; i++) {
+        while (queueCount(&txQueues[txOrder[i]]) > 0) {
+            transmitFrame(txOrder[i]);
+        }
+    }
+}
+
+void testFrame(void) {
+    // Check value for CRC-16/CCITT-FALSE is 0x29B1
+    uint16_t check = crc16(0xFFFF, (const uint8_t*)"123456789", 9);
+
+    // Control frame carrying "OK\0", escaping any FRAME_END in the CRC
+    uint8_t frame[] = {CHANNEL_CONTROL, 3, 'O', 'K', '\0', 0, 0};
+    uint16_t crc = crc16(0xFFFF, frame, 5);
+    frame[5] = crc >> 8;
+    frame[6] = crc & 0xFF;
+
+    int i;
+    decodeByte(FRAME_END);
+    for (i = 0; i < sizeof(frame); i++) {
+        if (frame[i] == FRAME_END) {
+            decodeByte(FRAME_ESC);
+            decodeByte(FRAME_ESC_END);
+        } else {
+            decodeByte(frame[i]);
+        }
+    }
+    decodeByte(FRAME_END);
+    deliverFrame();
+
+    int o = frameRead(CHANNEL_CONTROL);
+    int k = frameRead(CHANNEL_CONTROL);
+    int nul = frameRead(CHANNEL_CONTROL);
+    int none = frameRead(CHANNEL_CONTROL); // Should be -1
+
+    // Corrupted frame should be dropped with a CRC error
+    frame[2] = 'X';
+    decodeByte(FRAME_END);
+    for (i = 0; i < sizeof(frame); i++) {
+        decodeByte(frame[i]);
+    }
+    decodeByte(FRAME_END);
+    none = frameRead(CHANNEL_CONTROL);
+}
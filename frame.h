@@ -0,0 +1,92 @@
+/*
+ * frame.h
+ *
+ *      Description: Framing layer multiplexing several channels over the UART
+ *                   link. Each frame is
+ *
+ *                   [channel] [length] [payload ...] [CRC high] [CRC low]
+ *
+ *                   SLIP encoded and terminated by FRAME_END. The CRC is
+ *                   CRC-16/CCITT-FALSE over the channel, length and payload.
+ *                   Besides the usual SLIP escapes, XON and XOFF are escaped so
+ *                   software flow control stays transparent to the payload.
+ *
+ *                   Every channel has its own transmit and receive queue.
+ *                   Payloads are byte streams; frame boundaries carry no
+ *                   meaning above this layer.
+ *
+ *      Author: gibbonec
+ */
+
+#ifndef FRAME_H_
+#define FRAME_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FRAME_MAX_PAYLOAD   64
+
+#define FRAME_END           0xC0
+#define FRAME_ESC           0xDB
+#define FRAME_ESC_END       0xDC
+#define FRAME_ESC_ESC       0xDD
+#define FRAME_ESC_XON       0xDE
+#define FRAME_ESC_XOFF      0xDF
+
+typedef enum {
+    CHANNEL_HTTP,       // Requests to and responses from the forwarder
+    CHANNEL_CONTROL,    // NUL-terminated commands and replies, see control.h
+    CHANNEL_TELEMETRY,  // NUL-terminated reports from the device, never received
+    NUM_CHANNELS,
+} Channel;
+
+typedef struct {
+    uint32_t framesIn;      // Valid frames received
+    uint32_t framesOut;     // Frames transmitted
+    uint32_t crcErrors;     // Frames dropped for a bad CRC
+    uint32_t lengthErrors;  // Frames dropped for a length mismatch or overlong payload
+    uint32_t channelErrors; // Frames dropped for an unknown or transmit-only channel
+    uint32_t queueFull;     // Payloads refused by frameSend
+} FrameStats;
+
+extern FrameStats frameStats;
+
+/*
+ * Queues a payload for transmission on the given channel. The payload is
+ *  queued whole or not at all; returns false if there isn't room for it.
+ *  Posts TASK_LINK, which transmits it through frameProcess.
+ */
+bool frameSend(Channel channel, const void* data, size_t length);
+
+/*
+ * Returns the next received payload byte on the given channel, or -1 if
+ *  there is none.
+ */
+int frameRead(Channel channel);
+
+/*
+ * Discards everything received on the given channel.
+ */
+void frameFlush(Channel channel);
+
+/*
+ * Decodes received bytes into the channel receive queues and transmits all
+ *  queued payloads as frames, control first. A received frame waits in the
+ *  decoder, and the UART ring is left to fill, until its channel has room.
+ */
+void frameProcess(void);
+
+uint16_t crc16(uint16_t crc, const uint8_t* data, size_t length);
+
+void testFrame(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FRAME_H_ */
@@ -0,0 +1,68 @@
+#include "glyph.h"
+#include "lcd.h"
+
+// 5x8 bitmaps, one byte per row from the top
+const uint8_t bitmaps[NUM_GLYPHS][8] = {
+    [GLYPH_DEGREE]          = {0x0C, 0x12, 0x12, 0x0C, 0x00, 0x00, 0x00, 0x00},
+    [GLYPH_ARROW_N]         = {0x04, 0x0E, 0x15, 0x04, 0x04, 0x04, 0x04, 0x00},
+    [GLYPH_ARROW_NE]        = {0x0F, 0x03, 0x05, 0x09, 0x10, 0x00, 0x00, 0x00},
+    [GLYPH_ARROW_E]         = {0x00, 0x04, 0x02, 0x1F, 0x02, 0x04, 0x00, 0x00},
+    [GLYPH_ARROW_SE]        = {0x00, 0x00, 0x00, 0x10, 0x09, 0x05, 0x03, 0x0F},
+    [GLYPH_ARROW_S]         = {0x04, 0x04, 0x04, 0x04, 0x15, 0x0E, 0x04, 0x00},
+    [GLYPH_ARROW_SW]        = {0x00, 0x00, 0x00, 0x01, 0x12, 0x14, 0x18, 0x1E},
+    [GLYPH_ARROW_W]         = {0x00, 0x04, 0x08, 0x1F, 0x08, 0x04, 0x00, 0x00},
+    [GLYPH_ARROW_NW]        = {0x1E, 0x18, 0x14, 0x12, 0x01, 0x00, 0x00, 0x00},
+    [GLYPH_SUN]             = {0x00, 0x15, 0x0E, 0x1B, 0x0E, 0x15, 0x00, 0x00},
+    [GLYPH_PARTLY_CLOUDY]   = {0x05, 0x02, 0x07, 0x0C, 0x1E, 0x1F, 0x00, 0x00},
+    [GLYPH_CLOUD]           = {0x00, 0x0C, 0x1E, 0x1F, 0x1F, 0x00, 0x00, 0x00},
+    [GLYPH_FOG]             = {0x00, 0x1F, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00},
+    [GLYPH_RAIN]            = {0x0C, 0x1E, 0x1F, 0x00, 0x0A, 0x05, 0x0A, 0x00},
+    [GLYPH_SNOW]            = {0x00, 0x15, 0x0E, 0x1F, 0x0E, 0x15, 0x00, 0x00},
+    [GLYPH_THUNDER]         = {0x0C, 0x1E, 0x1F, 0x04, 0x08, 0x1C, 0x04, 0x08},
+};
+
+GlyphStats glyphStats;
+
+Glyph slots[GLYPH_SLOTS];       // Glyph loaded in each slot, GLYPH_NONE if empty
+uint32_t lastUsed[GLYPH_SLOTS]; // Lookup count at each slot's last use
+uint32_t lookups = 0;
+uint32_t frameStart = 0;        // Lookup count at the start of the frame
+
+char glyphChar(Glyph glyph) {
+    if (glyph <= GLYPH_NONE || glyph >= NUM_GLYPHS) return GLYPH_FALLBACK;
+    lookups++;
+
+    // Already loaded, or find the least recently used slot
+    int slot;
+    int victim = 0;
+    for (slot = 0; slot < GLYPH_SLOTS; slot++) {
+        if (slots[slot] == glyph) {
+            lastUsed[slot] = lookups;
+            glyphStats.hits++;
+            return GLYPH_FIRST_CODE + slot;
+        }
+        if (lastUsed[slot] < lastUsed[victim]) {
+            victim = slot;
+        }
+    }
+
+    // Everything loaded is on screen this frame
+    if (slots[victim] != GLYPH_NONE && lastUsed[victim] > frameStart) {
+        glyphStats.fallbacks++;
+        return GLYPH_FALLBACK;
+    }
+
+    if (slots[victim] != GLYPH_NONE) {
+        glyphStats.evictions++;
+    }
+    slots[victim] = glyph;
+    lastUsed[victim] = lookups;
+    uploadGlyph(victim, bitmaps[glyph]);
+    glyphStats.uploads++;
+
+    return GLYPH_FIRST_CODE + victim;
+}
+
+void glyphFrame(void) {
+    frameStart = lookups;
+}
@@ -0,0 +1,81 @@
+/*
+ * glyph.h
+ *
+ *      Description: Custom characters for the LCD. The HD44780 has 8 CGRAM
+ *                   slots, shown by character codes 0x08-0x0F (the same slots
+ *                   as 0x00-0x07, without using NUL). glyphChar maps a glyph to
+ *                   the code of a slot holding it, uploading the bitmap only
+ *                   when the glyph isn't already loaded and evicting the least
+ *                   recently used glyph when all slots are taken.
+ *
+ *                   Glyphs used since the last glyphFrame are never evicted,
+ *                   so a frame can use up to 8 glyphs. Beyond that, glyphChar
+ *                   returns GLYPH_FALLBACK.
+ *
+ *                   Glyphs below GLYPH_SYMBOLS can be embedded in layout
+ *                   strings by their value, see SYMBOL_DEGREE.
+ *
+ *      Author: gibbonec
+ */
+
+#ifndef GLYPH_H_
+#define GLYPH_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GLYPH_SLOTS 8
+#define GLYPH_FIRST_CODE 0x08
+#define GLYPH_FALLBACK '?'
+
+#define SYMBOL_DEGREE "\x01"
+
+typedef enum {
+    GLYPH_NONE,
+    GLYPH_DEGREE,
+    GLYPH_SYMBOLS,          // Glyphs from here on can't be embedded in strings
+    GLYPH_ARROW_N = GLYPH_SYMBOLS,
+    GLYPH_ARROW_NE,
+    GLYPH_ARROW_E,
+    GLYPH_ARROW_SE,
+    GLYPH_ARROW_S,
+    GLYPH_ARROW_SW,
+    GLYPH_ARROW_W,
+    GLYPH_ARROW_NW,
+    GLYPH_SUN,
+    GLYPH_PARTLY_CLOUDY,
+    GLYPH_CLOUD,
+    GLYPH_FOG,
+    GLYPH_RAIN,
+    GLYPH_SNOW,
+    GLYPH_THUNDER,
+    NUM_GLYPHS,
+} Glyph;
+
+typedef struct {
+    uint32_t hits;          // Lookups of a glyph already in CGRAM
+    uint32_t uploads;       // Glyphs written to CGRAM
+    uint32_t evictions;     // Uploads that replaced another glyph
+    uint32_t fallbacks;     // Lookups with every slot in use this frame
+} GlyphStats;
+
+extern GlyphStats glyphStats;
+
+/*
+ * Returns the character code showing a glyph, uploading it first if needed.
+ */
+char glyphChar(Glyph glyph);
+
+/*
+ * Starts a new frame, letting glyphs used so far be evicted.
+ */
+void glyphFrame(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GLYPH_H_ */
@@ -0,0 +1,137 @@
+#include "heap.h"
+#include "json.h"
+#include <stdlib.h>
+
+#define HEAP_NAME(subsystem, name) name,
+
+const char* const heapNames[NUM_HEAP_SUBSYSTEMS] = {
+    HEAP_SUBSYSTEMS(HEAP_NAME)
+};
+
+HeapStats heapStats[NUM_HEAP_SUBSYSTEMS];
+HeapStats heapTotal;
+
+#ifndef __MSP432P4111__
+// Host builds record each block's size and owner in front of it to check frees,
+//  aligned for anything stored after it
+typedef union {
+    struct {
+        size_t size;
+        HeapSubsystem subsystem;
+    } block;
+    long double align;
+} HeapHeader;
+
+HeapHeader* heapHeader(HeapSubsystem subsystem, void* ptr, size_t size) {
+    HeapHeader* header = (HeapHeader*)ptr - 1;
+    assert(header->block.subsystem == subsystem);
+    assert(header->block.size == size);
+    return header;
+}
+#endif
+
+void heapGrow(HeapStats* stats, size_t size) {
+    stats->live += size;
+    if (stats->live > stats->peak) stats->peak = stats->live;
+}
+
+void heapAdd(HeapSubsystem subsystem, size_t size) {
+    heapGrow(&heapStats[subsystem], size);
+    heapGrow(&heapTotal, size);
+}
+
+void heapRemove(HeapSubsystem subsystem, size_t size) {
+    heapStats[subsystem].live -= size;
+    heapTotal.live -= size;
+}
+
+void* heapAlloc(HeapSubsystem subsystem, size_t size) {
+#ifdef __MSP432P4111__
+    void* ptr = malloc(size);
+#else
+    HeapHeader* header = malloc(sizeof(HeapHeader) + size);
+    void* ptr = header ? header + 1 : NULL;
+    if (header) {
+        header->block.size = size;
+        header->block.subsystem = subsystem;
+    }
+#endif
+
+    if (!ptr) {
+        heapStats[subsystem].failures++;
+        heapTotal.failures++;
+        return NULL;
+    }
+
+    heapStats[subsystem].allocations++;
+    heapTotal.allocations++;
+    heapAdd(subsystem, size);
+    return ptr;
+}
+
+void* heapRealloc(HeapSubsystem subsystem, void* ptr, size_t oldSize, size_t newSize) {
+    if (!ptr) return heapAlloc(subsystem, newSize);
+
+#ifdef __MSP432P4111__
+    void* resized = realloc(ptr, newSize);
+#else
+    HeapHeader* header = realloc(heapHeader(subsystem, ptr, oldSize), sizeof(HeapHeader) + newSize);
+    void* resized = header ? header + 1 : NULL;
+    if (header) header->block.size = newSize;
+#endif
+
+    if (!resized) {
+        heapStats[subsystem].failures++;
+        heapTotal.failures++;
+        return NULL;
+    }
+
+    heapRemove(subsystem, oldSize);
+    heapAdd(subsystem, newSize);
+    return resized;
+}
+
+void heapFree(HeapSubsystem subsystem, void* ptr, size_t size) {
+    if (!ptr) return;
+
+#ifdef __MSP432P4111__
+    free(ptr);
+#else
+    free(heapHeader(subsystem, ptr, size));
+#endif
+
+    heapStats[subsystem].frees++;
+    heapTotal.frees++;
+    heapRemove(subsystem, size);
+}
+
+inline const char* heapName(HeapSubsystem subsystem) {
+    return heapNames[subsystem];
+}
+
+void testHeap(void) {
+    HeapStats before = heapStats[HEAP_REQUEST];
+
+    // Live bytes follow the block through a resize, the peak stays at the largest
+    char* block = heapAlloc(HEAP_REQUEST, 24);
+    block = heapRealloc(HEAP_REQUEST, block, 24, 40);
+    uint32_t grown = heapStats[HEAP_REQUEST].live - before.live;     // Should be 40
+    block = heapRealloc(HEAP_REQUEST, block, 40, 8);
+    uint32_t shrunk = heapStats[HEAP_REQUEST].live - before.live;    // Should be 8
+    heapFree(HEAP_REQUEST, block, 8);
+    uint32_t freed = heapStats[HEAP_REQUEST].live - before.live;     // Should be 0
+
+    // On the device a block larger than the heap fails and is counted
+    void* tooLarge = heapAlloc(HEAP_REQUEST, HEAP_SIZE * 2);
+    uint32_t failures = heapStats[HEAP_REQUEST].failures - before.failures;    // Should be 1
+    heapFree(HEAP_REQUEST, tooLarge, HEAP_SIZE * 2);
+
+    // Parsing and destroying a document should leave every parser subsystem where it was
+    uint32_t json = heapStats[HEAP_JSON].live;
+    uint32_t array = heapStats[HEAP_ARRAY].live;
+    uint32_t map = heapStats[HEAP_MAP].live;
+    JSONValue* value = parseJSON("{\"a\":[1,2,{\"b\":\"c\"}],\"d\":true}");
+    destroyJSON(value);
+    bool balanced = heapStats[HEAP_JSON].live == json && heapStats[HEAP_ARRAY].live == array
+            && heapStats[HEAP_MAP].live == map;                          // Should be true
+}
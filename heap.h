@@ -0,0 +1,104 @@
+/*
+ * heap.h
+ *
+ *      Description: Tracking allocator. Every malloc goes through heapAlloc
+ *                   with the subsystem it belongs to, which keeps live and
+ *                   peak bytes, allocation and free counts and failed
+ *                   allocations per subsystem and across the heap:
+ *
+ *                   X(subsystem, name)
+ *
+ *                   Frees pass the size that was allocated, which callers
+ *                   know from the type or capacity, so blocks carry no extra
+ *                   header on the device. Host builds do add a header, and
+ *                   assert that every free matches its allocation.
+ *
+ *                   Bytes are as requested, the C library's own per block
+ *                   overhead comes on top.
+ *
+ *      Author: gibbonec
+ */
+
+#ifndef HEAP_H_
+#define HEAP_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef __MSP432P4111__
+#include <assert.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Must match --heap_size in msp432p4111.cmd and in both build configurations
+//  of .cproject
+#define HEAP_SIZE 4096
+
+#define HEAP_SUBSYSTEMS(X) \
+    X(HEAP_JSON,    "json") \
+    X(HEAP_ARRAY,   "array") \
+    X(HEAP_MAP,     "map") \
+    X(HEAP_REQUEST, "request")
+
+#define HEAP_ENUM(subsystem, name) subsystem,
+
+typedef enum {
+    HEAP_SUBSYSTEMS(HEAP_ENUM)
+    NUM_HEAP_SUBSYSTEMS,
+} HeapSubsystem;
+
+typedef struct {
+    uint32_t live;          // Bytes allocated and not yet freed
+    uint32_t peak;          // Most bytes live at once
+    uint32_t allocations;
+    uint32_t frees;
+    uint32_t failures;      // Allocations that returned NULL
+} HeapStats;
+
+extern HeapStats heapStats[NUM_HEAP_SUBSYSTEMS];
+
+// Every subsystem together, the peak being of the sum
+extern HeapStats heapTotal;
+
+/*
+ * Allocates size bytes on behalf of a subsystem, returning NULL on failure.
+ */
+void* heapAlloc(HeapSubsystem subsystem, size_t size);
+
+/*
+ * Resizes a block from oldSize to newSize bytes. On failure the block is left
+ *  as it was and NULL is returned.
+ */
+void* heapRealloc(HeapSubsystem subsystem, void* ptr, size_t oldSize, size_t newSize);
+
+/*
+ * Frees a block of the given size, which must be the size it was allocated
+ *  with. Does nothing for NULL.
+ */
+void heapFree(HeapSubsystem subsystem, void* ptr, size_t size);
+
+/*
+ * Returns the name of a subsystem, for reports.
+ */
+const char* heapName(HeapSubsystem subsystem);
+
+/*
+ * Checks in host builds that a subsystem holds nothing, where everything it
+ *  allocated should have been freed.
+ */
+#ifdef __MSP432P4111__
+#define HEAP_ASSERT_EMPTY(subsystem)
+#else
+#define HEAP_ASSERT_EMPTY(subsystem) assert(heapStats[subsystem].live == 0)
+#endif
+
+void testHeap(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HEAP_H_ */
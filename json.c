@@ -1,4 +1,6 @@
 #include "json.h"
+#include "heap.h"
+#include "ramfunc.h"
 #include <string.h>
 #include <stdlib.h>
 #include <math.h>
@@ -9,16 +11,9 @@ const char* const exampleResponse = "{\"location\":{\"name\":\"Terre Haute\",\"r
 
 const char* cursor;
 
-size_t allocated_json = 0;
-
-// Wrappers around malloc and free to track memory usage
-#define MALLOC(size) \
-    ({  allocated_json += size; \
-        malloc(size); })
-
-#define FREE(ptr) \
-    ({  allocated_json -= sizeof(*(__typeof__(ptr)){NULL}); \
-        free(ptr); })
+// Wrappers around the tracking allocator, every block here is a single JSONValue or JSONString
+#define MALLOC(size) heapAlloc(HEAP_JSON, size)
+#define FREE(ptr) heapFree(HEAP_JSON, ptr, sizeof(*(ptr)))
 
 // Simplifies returning error in JSONValue struct
 #define ERR(jsonvalue, error) do { \
@@ -30,17 +25,19 @@ size_t allocated_json = 0;
 // Error propagation
 #define IS_ERR(jsonvalue) !jsonvalue || jsonvalue->type == JSONERR
 
-inline char next() {
+// The whole parser runs from SRAM with these, so the characters are read without
+//  a trampoline to or from flash
+RAMFUNC inline char next() {
     return *(cursor++);
 }
 
-inline char peek() {
+RAMFUNC inline char peek() {
     return *cursor;
 }
 
 // Helper function to parse NUL-terminated string
 // Does not consume any characters before confirming the match
-bool parseLiteral(const char* str) {
+RAMFUNC bool parseLiteral(const char* str) {
     while (*str != '\0') {
         if (*(str++) != peek()) {
             return false;
@@ -51,12 +48,18 @@ bool parseLiteral(const char* str) {
     return true;
 }
 
-JSONValue* parseJSON(const char* str) {
+RAMFUNC JSONValue* parseJSON(const char* str) {
     if (!str) return NULL;
     cursor = str;
     return parseObject();
 }
 
+RAMFUNC JSONValue* parseJSONValue(const char* str) {
+    if (!str) return NULL;
+    cursor = str;
+    return parseValue();
+}
+
 JSONValue* JSONGet(JSONValue* object, char* key) {
     if (!object || object->type != OBJECT) return NULL;
 
@@ -85,7 +88,7 @@ inline void destroyJSON(JSONValue* value) {
 }
 
 // Ellis
-JSONValue* parseObject(void) {
+RAMFUNC JSONValue* parseObject(void) {
     JSONValue* object = MALLOC(sizeof(JSONValue));
     if (!object) return NULL;
 
@@ -93,7 +96,10 @@ JSONValue* parseObject(void) {
     if (!map) ERR(object, MAP_ALLOC_ERR);
 
     // Parse opening bracket and whitespace
-    if (next() != '{') ERR(object, UNEXPECTED_CHAR);
+    if (next() != '{') {
+        destroyMap(map, destroyJSONVoid);
+        ERR(object, UNEXPECTED_CHAR);
+    }
     parseWhitespace();
 
     if (peek() == '}') {
@@ -112,22 +118,30 @@ JSONValue* parseObject(void) {
             parseWhitespace();
 
             // Parse colon
-            if (next() != ':') ERR(object, UNEXPECTED_CHAR);
+            if (next() != ':') {
+                destroyJSON(str);
+                destroyMap(map, destroyJSONVoid);
+                ERR(object, UNEXPECTED_CHAR);
+            }
 
             // Parse value
             JSONValue* value = parseValue();
             if (IS_ERR(value)) {
+                destroyJSON(str);
                 destroyMap(map, destroyJSONVoid);
                 FREE(object);
                 return value;
             }
 
-            // Add key-value pair to map
+            // Add key-value pair to map, the key points into the input so its string can go
             JSONString* key = str->value.str;
-            MapErr err = mapInsert(map, key->str, key->length, (void*)value);
-            if (err) ERR(object, err);
-
+            MapErr err = mapInsert(map, key->str, key->length, (void*)value, destroyJSONVoid);
             destroyJSON(str);
+            if (err) {
+                destroyJSON(value);
+                destroyMap(map, destroyJSONVoid);
+                ERR(object, err);
+            }
 
             // Parse comma or break, then whitespace
             if (peek() != ',') break;
@@ -135,7 +149,10 @@ JSONValue* parseObject(void) {
             parseWhitespace();
         }
 
-        if (next() != '}') ERR(object, UNEXPECTED_CHAR);
+        if (next() != '}') {
+            destroyMap(map, destroyJSONVoid);
+            ERR(object, UNEXPECTED_CHAR);
+        }
     }
 
     object->type = OBJECT;
@@ -144,7 +161,7 @@ JSONValue* parseObject(void) {
 }
 
 // Connor
-JSONValue* parseArray(void) {
+RAMFUNC JSONValue* parseArray(void) {
     JSONValue* newJSONArray = MALLOC(sizeof(JSONValue));
     if (!newJSONArray) return NULL;
 
@@ -152,7 +169,10 @@ JSONValue* parseArray(void) {
     if (!modifiableArray) ERR(newJSONArray, ARRAY_ALLOC_ERR);
 
     // Parse opening bracket and whitespace
-    if (next() != '[') return NULL;
+    if (next() != '[') {
+        destroyArray(modifiableArray, destroyJSONVoid);
+        ERR(newJSONArray, UNEXPECTED_CHAR);
+    }
     parseWhitespace();
 
     if (peek() == ']') {
@@ -170,6 +190,7 @@ JSONValue* parseArray(void) {
 
             ArrayErr err = arrayAppend(modifiableArray, value);
             if (err) {
+                destroyJSON(value);
                 destroyArray(modifiableArray, destroyJSONVoid);
                 ERR(newJSONArray, err);
             }
@@ -192,7 +213,7 @@ JSONValue* parseArray(void) {
 
 
 // Ellis
-inline JSONValue* parseValue(void) {
+RAMFUNC inline JSONValue* parseValue(void) {
     parseWhitespace();
 
     JSONValue* value = NULL;
@@ -225,7 +246,7 @@ inline JSONValue* parseValue(void) {
 }
 
 // Connor
-JSONValue* parseString(void) {
+RAMFUNC JSONValue* parseString(void) {
     JSONValue* newJSONString = MALLOC(sizeof(JSONValue));
     if (!newJSONString) return NULL;
 
@@ -280,7 +301,7 @@ JSONValue* parseString(void) {
 }
 
 // Ellis
-JSONValue* parseNumber(void) {
+RAMFUNC JSONValue* parseNumber(void) {
     JSONValue* number = MALLOC(sizeof(JSONValue));
     if (!number) return NULL;
 
@@ -356,7 +377,7 @@ JSONValue* parseNumber(void) {
 //const char t[] = "true";
 //const char f[] = "false";
 
-JSONValue* parseBool(void) {
+RAMFUNC JSONValue* parseBool(void) {
 //
 //    int i;
 //    if (peek() == 't') {
@@ -392,7 +413,7 @@ JSONValue* parseBool(void) {
 }
 
 // Ellis
-JSONValue* parseNull(void) {
+RAMFUNC JSONValue* parseNull(void) {
     JSONValue* value = MALLOC(sizeof(JSONValue));
     if (!value) return NULL;
 
@@ -403,7 +424,7 @@ JSONValue* parseNull(void) {
 }
 
 // Connor
-void parseWhitespace(void) {
+RAMFUNC void parseWhitespace(void) {
     while (peek() == ' ' || peek() == '\n' || peek() == '\r' || peek() == '\t') {
         next();
     }
@@ -37,8 +37,13 @@ typedef struct {
     } value;
 } JSONValue;
 
+// Sample current weather response, for tests and benchmarks
+extern const char* const exampleResponse;
+
 JSONValue* parseJSON(const char* str);
 
+JSONValue* parseJSONValue(const char* str);
+
 JSONValue* JSONGet(JSONValue* object, char* key);
 
 void destroyJSON(JSONValue* value);
@@ -0,0 +1,57 @@
+/*
+ * layout.h
+ *
+ *      Description: Screen layout. Every field shown on the LCD is one row of
+ *                   LAYOUT, which generates the LCDField enum and the table
+ *                   display.c renders pages from:
+ *
+ *                   X(field, label, topic, formatter, width, decimals, unit, detail, detailFormatter, detailWidth)
+ *
+ *                   field        LCDField name
+ *                   label        Text before the value
+ *                   topic        Reading the value is rendered from, see notify.h
+ *                   formatter    renderNumber, renderText, renderCondition or renderArrow, see display.c
+ *                   width        Minimum width of the value
+ *                   decimals     Decimals shown for numbers
+ *                   unit         Text after the value
+ *                   detail       Optional reading shown after the unit, or TOPIC_NONE
+ *                   detailFormatter  Formatter for the detail, or NULL
+ *                   detailWidth  Minimum width of the detail
+ *
+ *                   Labels and units may embed glyphs such as SYMBOL_DEGREE.
+ *
+ *                   A page is rendered again only when one of its readings
+ *                   changes. Rows that can't fit on a line fail the build.
+ *                   Adding a field only takes a new row.
+ *
+ *      Author: gibbonec
+ */
+
+#ifndef LAYOUT_H_
+#define LAYOUT_H_
+
+#include "glyph.h"
+#include "notify.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LAYOUT(X) \
+    X(TEMP,      "Temp: ",     TOPIC_TEMP,      renderNumber,    8,  3, SYMBOL_DEGREE "F", TOPIC_NONE,     NULL,        0) \
+    X(HUMIDITY,  "Humidity: ", TOPIC_HUMIDITY,  renderNumber,    5,  2, "%",               TOPIC_NONE,     NULL,        0) \
+    X(CONDITION, "",           TOPIC_CONDITION, renderCondition, 16, 0, "",                TOPIC_NONE,     NULL,        0) \
+    X(WIND,      "Wind: ",     TOPIC_WIND,      renderNumber,    3,  1, " mph ",           TOPIC_WIND_DIR, renderArrow, 1)
+
+#define LAYOUT_FIELD(field, label, topic, formatter, width, decimals, unit, detail, detailFormatter, detailWidth) field,
+
+typedef enum {
+    LAYOUT(LAYOUT_FIELD)
+    NUM_FIELDS,
+} LCDField;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LAYOUT_H_ */
@@ -8,7 +8,9 @@
  *                            R/W --->GND
  *                P4  <-----> DB
  *
- *          This module uses SysTick timer for delays.
+ *          Instructions are queued and written from the TIMER_A1
+ *          interrupt, which waits out each one's execution time before
+ *          the next, so a write only waits when the queue is full.
  *
  *      Author: ece230
  */
@@ -16,16 +18,67 @@
 #include <msp.h>
 
 #include "lcd.h"
-#include "sysTickDelays.h"
+#include "profile.h"
+#include "trace.h"
+#include "clock.h"
+#include <string.h>
 
 #define NONHOME_MASK        0xFC
 
 #define LONG_INSTR_DELAY    2000
 #define SHORT_INSTR_DELAY   50
+#define ENABLE_PULSE        1
+
+#define DELAY_MODE          2   // Queue entry that only waits
+#define QUEUE_MASK          (LCD_QUEUE_SIZE - 1)
+
+// A refresh queues without waiting for the bus only if it fits in the queue
+#if LCD_QUEUE_SIZE < LCD_REFRESH_MAX
+#error "LCD_QUEUE_SIZE is too small for a full refresh"
+#endif
+
+#define FULL_REWRITE        (LCD_LINES * (LCD_COLUMNS + 1)) // Cursor moves plus data for every cell
+
+/* Instruction queue entry */
+typedef struct {
+    uint8_t mode;       // CTRL_MODE, DATA_MODE or DELAY_MODE
+    uint8_t value;      // Instruction/data to write to LCD
+    uint16_t delay;     // Time to wait after the write in us
+} LCDInstruction;
+
+/* Phase of the instruction being written by the timer ISR */
+typedef enum {
+    PHASE_IDLE,     // Timer stopped, queue empty
+    PHASE_ENABLE,   // E is high for the enable pulse
+    PHASE_EXECUTE,  // Waiting for the LCD to execute the instruction
+} LCDPhase;
 
 LCDField field1 = TEMP;
 LCDField field2 = HUMIDITY;
 
+LCDStats lcdStats;
+
+// Written by the caller at head and drained by the ISR at tail
+LCDInstruction lcdQueue[LCD_QUEUE_SIZE];
+volatile unsigned int lcdHead = 0;
+volatile unsigned int lcdTail = 0;
+volatile LCDPhase lcdPhase = PHASE_IDLE;
+
+// What refreshLCD should show, and what the LCD will show once the queue drains
+char lcdShadow[LCD_LINES][LCD_LINE_LENGTH];
+char lcdPanel[LCD_LINES][LCD_LINE_LENGTH];
+uint8_t lcdCursor = 0;  // DDRAM address the next data write goes to
+bool lcdCgram = false;  // Data writes are going to CGRAM
+int lcdShift = 0;       // Columns the display is shifted left
+
+uint32_t lcdTicksPerMs = 0;
+volatile uint32_t latencyTicks = 0; // Timer ticks since the queue last left idle
+
+// Keeps the phase timing in step with SMCLK
+void lcdClock(uint32_t mclk, uint32_t smclk) {
+    lcdTicksPerMs = smclk / LCD_TIMER_DIVIDER / 1000;
+}
+
 void configLCD(uint32_t clkFreq) {
     // configure pins as GPIO
     LCD_DB_PORT->SEL0 = 0;
@@ -41,60 +94,195 @@ void configLCD(uint32_t clkFreq) {
     LCD_RS_PORT->DIR |= LCD_RS_MASK;
     LCD_EN_PORT->DIR |= LCD_EN_MASK;
 
-    initDelayTimer(clkFreq);
+    // TIMER_A1 paces the queue, restarted in up mode for each phase
+    lcdTicksPerMs = clkFreq / LCD_TIMER_DIVIDER / 1000;
+    TIMER_A1->CTL = TIMER_A_CTL_MC__STOP;
+    TIMER_A1->EX0 = TIMER_A_EX0_IDEX__6;
+    TIMER_A1->CCTL[0] = TIMER_A_CCTLN_CCIE;
+
+    NVIC->ISER[0] = 1 << TA1_0_IRQn;
+    clockSubscribe(lcdClock);
 }
 
 /*!
- * Delay method based on instruction execution time.
+ * Delay based on instruction execution time.
  *   Execution times from Table 6 of HD44780 data sheet, with buffer.
  *
  * \param mode RS mode selection
  * \param instruction Instruction/data to write to LCD
  *
- * \return None
+ * \return Time to wait after the instruction in us
  */
-void instructionDelay(uint8_t mode, uint8_t instruction) {
+uint16_t instructionDelay(uint8_t mode, uint8_t instruction) {
     // if instruction is Return Home or Clear Display, use long delay for
     //  instruction execution; otherwise, use short delay
     if ((mode == DATA_MODE) || (instruction & NONHOME_MASK)) {
-        delayMicroSec(SHORT_INSTR_DELAY);
+        return SHORT_INSTR_DELAY;
     }
     else {
-        delayMicroSec(LONG_INSTR_DELAY);
+        return LONG_INSTR_DELAY;
     }
 }
 
 /*!
- * Function to write instruction/data to LCD.
+ * Starts TIMER_A1 to interrupt after the given time.
  *
- * \param mode          Write mode: 0 - control, 1 - data
- * \param instruction   Instruction/data to write to LCD
+ * \param micros Time until the interrupt in us
  *
  * \return None
  */
-void writeInstruction(uint8_t mode, uint8_t instruction) {
-    // TODO set 8-bit data on LCD DB port
-    LCD_DB_PORT->OUT = instruction;
+void startPhase(uint16_t micros) {
+    uint32_t ticks = (micros * lcdTicksPerMs + 999) / 1000;
+    if (ticks == 0) ticks = 1;
+    if (ticks > 0x10000) ticks = 0x10000;
+
+    // Restart from zero so the new period applies immediately
+    TIMER_A1->CTL = TIMER_A_CTL_MC__STOP;
+    TIMER_A1->CCR[0] = ticks - 1;
+    TIMER_A1->CTL = TIMER_A_CTL_SSEL__SMCLK | TIMER_A_CTL_ID__2 | TIMER_A_CTL_MC__UP | TIMER_A_CTL_CLR;
+    latencyTicks += ticks;
+}
+
+/*!
+ * Starts writing the instruction at the tail of the queue. Called from the
+ *  ISR, or with the queue idle.
+ *
+ * \return None
+ */
+void startInstruction(void) {
+    LCDInstruction* instruction = &lcdQueue[lcdTail & QUEUE_MASK];
+
+    if (instruction->mode == DELAY_MODE) {
+        lcdPhase = PHASE_EXECUTE;
+        startPhase(instruction->delay);
+        return;
+    }
 
-    // TODO set RS for data or control instruction mode
+    // set 8-bit data on LCD DB port
+    LCD_DB_PORT->OUT = instruction->value;
+
+    // set RS for data or control instruction mode
     //      use bit-masking to avoid affecting other pins of port
-    if (mode == DATA_MODE) {
+    if (instruction->mode == DATA_MODE) {
         LCD_RS_PORT->OUT |= LCD_RS_MASK;
     } else {
         LCD_RS_PORT->OUT &= ~LCD_RS_MASK;
     }
-    // pulse E to execute instruction on LCD
-    // TODO set Enable signal high
-    //      use bit-masking to avoid affecting other pins of port
+
+    // pulse E to execute instruction on LCD, lowered by the next interrupt
     LCD_EN_PORT->OUT |= LCD_EN_MASK;
+    lcdPhase = PHASE_ENABLE;
+    startPhase(ENABLE_PULSE);
 
-    delayMicroSec(1);
-    // TODO set Enable signal low
-    //      use bit-masking to avoid affecting other pins of port
-    LCD_EN_PORT->OUT &= ~LCD_EN_MASK;
+    lcdStats.instructions++;
+}
 
-    // delay to allow instruction execution to complete
-    instructionDelay(mode, instruction);
+/*!
+ * Function to queue an instruction or delay for the LCD. Waits for room if
+ *  the queue is full.
+ *
+ * \param mode          Write mode: 0 - control, 1 - data, 2 - delay only
+ * \param instruction   Instruction/data to write to LCD
+ * \param delay         Time to wait after the instruction in us
+ *
+ * \return None
+ */
+void queueInstruction(uint8_t mode, uint8_t instruction, uint16_t delay) {
+    if (lcdQueueDepth() == LCD_QUEUE_SIZE) {
+        lcdStats.stalls++;
+        while (lcdQueueDepth() == LCD_QUEUE_SIZE);
+    }
+
+    LCDInstruction* entry = &lcdQueue[lcdHead & QUEUE_MASK];
+    entry->mode = mode;
+    entry->value = instruction;
+    entry->delay = delay;
+    lcdHead++;
+
+    unsigned int depth = lcdQueueDepth();
+    if (depth > lcdStats.queueHighWater) {
+        lcdStats.queueHighWater = depth;
+    }
+
+    // The ISR sees the new entry unless it had already gone idle, so kick it
+    if (lcdPhase == PHASE_IDLE) {
+        latencyTicks = 0;
+        startInstruction();
+    }
+}
+
+/*!
+ * Function to mirror the effect of an instruction on the cursor and panel, so
+ *  refreshLCD can diff against what the LCD shows.
+ *
+ * \param mode          Write mode: 0 - control, 1 - data
+ * \param instruction   Instruction/data to write to LCD
+ *
+ * \return None
+ */
+void trackInstruction(uint8_t mode, uint8_t instruction) {
+    if (mode == DATA_MODE && lcdCgram) {
+        return;
+    } else if (mode == DATA_MODE) {
+        int line = lcdCursor >= LINE2_OFFSET;
+        int column = lcdCursor - (line ? LINE2_OFFSET : LINE1_OFFSET);
+        if (column < LCD_LINE_LENGTH) {
+            lcdPanel[line][column] = instruction;
+        }
+
+        // DDRAM address increments, wrapping from the end of one line to the start of the other
+        lcdCursor++;
+        if (lcdCursor == LINE1_OFFSET + LCD_LINE_LENGTH) {
+            lcdCursor = LINE2_OFFSET;
+        } else if (lcdCursor == LINE2_OFFSET + LCD_LINE_LENGTH) {
+            lcdCursor = LINE1_OFFSET;
+        }
+    } else if (instruction & SET_DDRAM_MASK) {
+        lcdCursor = instruction & ~SET_DDRAM_MASK;
+        lcdCgram = false;
+    } else if (instruction & SET_CGRAM_MASK) {
+        // The DDRAM address is lost, so the next refresh has to set it
+        lcdCursor = 0xFF;
+        lcdCgram = true;
+    } else if ((instruction & ~(SC_FLAG_MASK | RL_FLAG_MASK | 0x03)) == CURSOR_SHIFT_MASK) {
+        if (instruction & SC_FLAG_MASK) {
+            // Display shift leaves the cursor alone, and wraps around the line
+            lcdShift = (lcdShift + ((instruction & RL_FLAG_MASK) ? LCD_LINE_LENGTH - 1 : 1)) % LCD_LINE_LENGTH;
+        }
+    } else if (instruction == CLEAR_DISPLAY_MASK) {
+        memset(lcdPanel, ' ', sizeof(lcdPanel));
+        lcdCursor = LINE1_OFFSET;
+        lcdCgram = false;
+        lcdShift = 0;
+    } else if (!(instruction & NONHOME_MASK)) {
+        lcdCursor = LINE1_OFFSET;
+        lcdCgram = false;
+        lcdShift = 0;
+    }
+}
+
+/*!
+ * Function to write instruction/data to LCD.
+ *
+ * \param mode          Write mode: 0 - control, 1 - data
+ * \param instruction   Instruction/data to write to LCD
+ *
+ * \return None
+ */
+void writeInstruction(uint8_t mode, uint8_t instruction) {
+    trackInstruction(mode, instruction);
+    queueInstruction(mode, instruction, instructionDelay(mode, instruction));
+}
+
+/*!
+ * Function to queue a wait with no instruction.
+ *
+ * \param micros Time to wait in us
+ *
+ * \return None
+ */
+void waitInstruction(uint16_t micros) {
+    queueInstruction(DELAY_MODE, 0, micros);
 }
 
 /*!
@@ -123,21 +311,22 @@ void dataInstruction(uint8_t data) {
 void initLCD(void) {
     // follows initialization sequence described for 8-bit data mode in
     //  Figure 23 of HD447780 data sheet
-    delayMilliSec(40);
+    memset(lcdShadow, ' ', sizeof(lcdShadow));
+    waitInstruction(40000);
     commandInstruction(FUNCTION_SET_MASK | DL_FLAG_MASK);
-    delayMilliSec(5);
+    waitInstruction(5000);
     commandInstruction(FUNCTION_SET_MASK | DL_FLAG_MASK);
-    delayMicroSec(150);
+    waitInstruction(150);
     commandInstruction(FUNCTION_SET_MASK | DL_FLAG_MASK);
-    delayMicroSec(SHORT_INSTR_DELAY);
+    waitInstruction(SHORT_INSTR_DELAY);
     commandInstruction(FUNCTION_SET_MASK | DL_FLAG_MASK | N_FLAG_MASK);
-    delayMicroSec(SHORT_INSTR_DELAY);
+    waitInstruction(SHORT_INSTR_DELAY);
     commandInstruction(DISPLAY_CTRL_MASK);
-    delayMicroSec(SHORT_INSTR_DELAY);
+    waitInstruction(SHORT_INSTR_DELAY);
     commandInstruction(CLEAR_DISPLAY_MASK);
-    delayMicroSec(SHORT_INSTR_DELAY);
+    waitInstruction(SHORT_INSTR_DELAY);
     commandInstruction(ENTRY_MODE_MASK | ID_FLAG_MASK);
-    delayMicroSec(LONG_INSTR_DELAY);
+    waitInstruction(LONG_INSTR_DELAY);
 
     // after initialization and configuration, turn display ON
     commandInstruction(DISPLAY_CTRL_MASK | D_FLAG_MASK);
@@ -163,8 +352,135 @@ void setCursorSecondLine() {
     commandInstruction(SET_DDRAM_MASK | LINE2_OFFSET);
 }
 
+void writeLine(int line, const char* text) {
+    int length = 0;
+    while (length < LCD_COLUMNS && text[length] != '\0') length++;
+    writeLongLine(line, text, length);
+}
+
+void writeLongLine(int line, const char* text, int length) {
+    int i;
+    for (i = 0; i < LCD_LINE_LENGTH && i < length; i++) {
+        lcdShadow[line][i] = text[i];
+    }
+    for (; i < LCD_LINE_LENGTH; i++) {
+        lcdShadow[line][i] = ' ';
+    }
+}
+
+void uploadGlyph(int slot, const uint8_t rows[8]) {
+    commandInstruction(SET_CGRAM_MASK | (slot << 3));
+
+    int i;
+    for (i = 0; i < 8; i++) {
+        dataInstruction(rows[i]);
+    }
+}
+
+void shiftDisplayLeft(void) {
+    commandInstruction(CURSOR_SHIFT_MASK | SC_FLAG_MASK);
+}
+
+void unshiftDisplay(void) {
+    // Return home also moves the cursor, which refreshLCD copes with
+    if (lcdShift != 0) {
+        commandInstruction(RETURN_HOME_MASK);
+    }
+}
+
+inline int displayShift(void) {
+    return lcdShift;
+}
+
+void refreshLCD(void) {
+    unsigned int writes = 0;
+
+    int line;
+    for (line = 0; line < LCD_LINES; line++) {
+        uint8_t base = line ? LINE2_OFFSET : LINE1_OFFSET;
+        int column = 0;
+        while (column < LCD_LINE_LENGTH) {
+            if (lcdShadow[line][column] == lcdPanel[line][column]) {
+                column++;
+                continue;
+            }
+
+            // Rewriting a single unchanged cell costs the same as moving the
+            //  cursor past it, so only move for gaps of two or more
+            if (lcdCursor != base + column) {
+                commandInstruction(SET_DDRAM_MASK | (base + column));
+                writes++;
+            }
+            while (column < LCD_LINE_LENGTH
+                    && (lcdShadow[line][column] != lcdPanel[line][column]
+                    || (column + 1 < LCD_LINE_LENGTH && lcdShadow[line][column + 1] != lcdPanel[line][column + 1]))) {
+                dataInstruction(lcdShadow[line][column]);
+                writes++;
+                column++;
+            }
+        }
+    }
+
+    lcdStats.frames++;
+    lcdStats.lastWrites = writes;
+    // Long lines can take more than a full rewrite of the visible cells
+    lcdStats.lastSaved = writes < FULL_REWRITE ? FULL_REWRITE - writes : 0;
+    lcdStats.totalSaved += lcdStats.lastSaved;
+}
+
 void cycleLCD() {
     // Cycle data displayed on LCD
     field1 = ++field1 % NUM_FIELDS;
     field2 = ++field2 % NUM_FIELDS;
 }
+
+inline unsigned int lcdQueueDepth(void) {
+    return lcdHead - lcdTail;
+}
+
+inline bool lcdIdle(void) {
+    return lcdPhase == PHASE_IDLE;
+}
+
+void lcdFlush(void) {
+    while (!lcdIdle());
+}
+
+// Moves the bus on to the next phase of the queue
+void stepQueue(void) {
+    TRACE(TRACE_LCD_STEP, lcdPhase, lcdQueueDepth());
+
+    if (lcdPhase == PHASE_ENABLE) {
+        // End the enable pulse and wait for the instruction to execute
+        LCD_EN_PORT->OUT &= ~LCD_EN_MASK;
+        lcdPhase = PHASE_EXECUTE;
+        startPhase(lcdQueue[lcdTail & QUEUE_MASK].delay);
+        return;
+    }
+
+    // Instruction finished, move on to the next
+    lcdTail++;
+    if (lcdQueueDepth() > 0) {
+        startInstruction();
+        return;
+    }
+
+    TIMER_A1->CTL = TIMER_A_CTL_MC__STOP;
+    lcdPhase = PHASE_IDLE;
+
+    lcdStats.lastLatency = latencyTicks * 1000 / lcdTicksPerMs;
+    if (lcdStats.lastLatency > lcdStats.maxLatency) {
+        lcdStats.maxLatency = lcdStats.lastLatency;
+    }
+}
+
+// Timer interrupt to step through the instruction queue
+void TA1_0_IRQHandler(void) {
+    PROFILE_BEGIN(PROFILE_LCD_ISR);
+
+    // Clear compare interrupt flag
+    TIMER_A1->CCTL[0] &= ~TIMER_A_CCTLN_CCIFG;
+    stepQueue();
+
+    PROFILE_END(PROFILE_LCD_ISR);
+}
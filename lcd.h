@@ -8,7 +8,10 @@
  *                            R/W --->GND
  *                P4  <-----> DB
  *
- *          This module uses SysTick timer for delays.
+ *          Writes are asynchronous. Instructions are queued and TIMER_A1,
+ *          clocked from SMCLK / 12 for 1 us ticks at 12 MHz, drains the
+ *          queue from its interrupt, waiting out each instruction's
+ *          execution time between writes.
  *
  *      Author: ece230
  */
@@ -28,22 +31,9 @@ extern "C"
 #endif
 
 #include <msp.h>
+#include <stdbool.h>
 
-/*
- * For now, simple implementation of keeping track of fields to display is by numbering them 0-n, where is is (how many fields we have - 1)
- *
- * Temp = 0
- * Humidity = 1
- * Condition = 2
- */
-
-typedef enum {
-    TEMP,
-    HUMIDITY,
-    CONDITION,
-    WIND,
-    NUM_FIELDS,
-} LCDField;
+#include "layout.h"
 
 extern LCDField field1;  // Top line data, starting with temp
 extern LCDField field2;  // Bottom line data, starting with humidity
@@ -60,6 +50,14 @@ extern LCDField field2;  // Bottom line data, starting with humidity
 #define LINE2_OFFSET        0x40
 #define LINE1_SPACE_14      0xD
 
+#define LCD_LINES           2
+#define LCD_COLUMNS         16
+#define LCD_LINE_LENGTH     40      // DDRAM columns per line, shown through a 16 column window
+
+#define LCD_QUEUE_SIZE      128     // Instructions, enough for a full refresh. Must be a power of 2
+#define LCD_REFRESH_MAX     (LCD_LINES * (1 + LCD_LINE_LENGTH)) // Most a refresh queues, a cursor move and every cell of each line
+#define LCD_TIMER_DIVIDER   12      // SMCLK / 2 / 6, 1 us per tick at 12 MHz
+
 /* Instruction masks */
 #define CLEAR_DISPLAY_MASK  0x01
 #define RETURN_HOME_MASK    0x02
@@ -68,6 +66,7 @@ extern LCDField field2;  // Bottom line data, starting with humidity
 #define DISPLAY_CTRL_MASK   0x08
 #define CURSOR_SHIFT_MASK   0x10
 #define FUNCTION_SET_MASK   0x20
+#define SET_CGRAM_MASK      0x40
 #define SET_DDRAM_MASK      0x80
 #define SET_CURSOR_MASK     0x100
 
@@ -100,6 +99,20 @@ extern LCDField field2;  // Bottom line data, starting with humidity
 #define B_FLAG_MASK         0x01
 #define S_FLAG_MASK         0x01
 
+typedef struct {
+    unsigned int queueHighWater;    // Most instructions ever waiting in the queue
+    uint32_t instructions;          // Instructions written to the LCD
+    uint32_t stalls;                // Writes that had to wait for room in the queue
+    uint32_t lastLatency;           // Time from queueing into an idle queue until it drained in us
+    uint32_t maxLatency;            // Longest such time in us
+    uint32_t frames;                // Calls to refreshLCD
+    unsigned int lastWrites;        // Instructions queued by the last refreshLCD
+    unsigned int lastSaved;         // Instructions the last refreshLCD saved over a full rewrite
+    uint32_t totalSaved;            // Instructions saved by every refreshLCD
+} LCDStats;
+
+extern LCDStats lcdStats;
+
 extern int data1;
 extern int data2;
 extern const char temp[];
@@ -111,10 +124,10 @@ extern const char text[];
  *  \brief This function configures the selected pins for an LCD
  *
  *  This function configures the selected pins as output pins to interface
- *      with a Hitachi HD44780 LCD in 8-bit mode. Also initializes sysTickDelay
- *      library based on system clock frequency.
+ *      with a Hitachi HD44780 LCD in 8-bit mode. Also configures TIMER_A1 to
+ *      drain the instruction queue, based on the SMCLK frequency.
  *
- *  \param clkFreq is the frequency of the system clock (MCLK) in Hz
+ *  \param clkFreq is the frequency of SMCLK in Hz
  *
  *  Modified bits of \b P2DIR register and \b P4DIR register, and bits of
  *      \b P2SEL and \b P4SEL registers.
@@ -126,8 +139,8 @@ extern void configLCD(uint32_t clkFreq);
 /*!
  *  \brief This function initializes LCD
  *
- *  This function generates initialization sequence for LCD for 8-bit mode.
- *      Delays set by worst-case 2.7 V
+ *  This function queues the initialization sequence for LCD for 8-bit mode
+ *      and returns without waiting for it. Delays set by worst-case 2.7 V
  *
  *  \return None
  */
@@ -169,6 +182,65 @@ extern void setGRange();
  */
 extern void cycleLCD();
 
+/*
+ *  This function renders a line of text into the shadow framebuffer, padded
+ *      with spaces to the width of the display. Nothing is written to the LCD
+ *      until refreshLCD.
+ */
+extern void writeLine(int line, const char* text);
+
+/*
+ *  This function renders up to LCD_LINE_LENGTH characters of text into a line
+ *      of the shadow framebuffer, for scrolling into view with shiftDisplayLeft.
+ */
+extern void writeLongLine(int line, const char* text, int length);
+
+/*
+ *  This function writes a 5x8 character bitmap, one byte per row from the
+ *      top, to a CGRAM slot from 0 to 7
+ */
+extern void uploadGlyph(int slot, const uint8_t rows[8]);
+
+/*
+ *  This function shifts both lines of the display one column left, bringing
+ *      the next DDRAM column of each line into view. Costs one instruction.
+ */
+extern void shiftDisplayLeft(void);
+
+/*
+ *  This function undoes any display shift, returning the window to DDRAM
+ *      column 0
+ */
+extern void unshiftDisplay(void);
+
+/*
+ *  This function returns how many columns the display is shifted left
+ */
+extern int displayShift(void);
+
+/*
+ *  This function writes the cells of the shadow framebuffer that differ from
+ *      what the LCD shows, moving the cursor only across runs of unchanged
+ *      cells too long to rewrite.
+ */
+extern void refreshLCD(void);
+
+/*
+ *  This function returns the number of instructions waiting to be written
+ */
+extern unsigned int lcdQueueDepth(void);
+
+/*
+ *  This function returns true once every queued instruction has been written
+ *      and has finished executing
+ */
+extern bool lcdIdle(void);
+
+/*
+ *  This function waits until the LCD is idle. Interrupts must be enabled
+ */
+extern void lcdFlush(void);
+
 //*****************************************************************************
 //
 // Mark the end of the C bindings section for C++ compilers.
@@ -5,110 +5,104 @@
 #include "map.h"
 #include "array.h"
 #include "lcd.h"
+#include "display.h"
+#include "format.h"
+#include "notify.h"
+#include "stream.h"
+#include "timebase.h"
+#include "profile.h"
+#include "trace.h"
+#include "heap.h"
+#include "stack.h"
+#include "ramfunc.h"
+#include "clock.h"
+#include "event.h"
+#include "task.h"
+#include "timer.h"
+#include "request.h"
+#include "uart.h"
+#include "baud.h"
+#include "frame.h"
+#include "control.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 // #define TEST
-#define BUFFER_SIZE 320
 #define CLK_FREQUENCY 48000000 // MCLK using 48MHz HFXT
-#define TIMER_TICKS 1250 // 5 s * (32kHz / 128)
+#define ACLK_FREQUENCY 256 // 32kHz / 128
+#define BUTTON_DEBOUNCE 50 // ms the button is ignored after a press
 
 /* Global Variables */
-const char httpRequest[] = "GET /v1/current.json?key=921e078dd8a44054a06172330242501&q=47803 HTTP/1.1\nHost: api.weatherapi.com\nUser-Agent: Windows NT 10.0; +https://github.com/spectre256/forwarder Forwarder/0.0.1\nAccept: application/json\n\n";
-
 JSONValue* json = NULL;
 JSONValue* current = NULL;
+int site = 0; // Location currently shown on the LCD
 
-volatile char* buffer;
-volatile int buffer_i = 0;
-volatile int nl_cnt = 0;
-volatile bool responseReady = false;
-
-/*
- * This function prints a (NUL-terminated) message over UART. Assumes configuration
- *  of eUSCI_A0 for UART transmit.
- *
- *  TODO: Move to uart.c
- */
-void printMessage(const char* const message) {
-    int i;
-    for (i = 0; i == 0 || message[i - 1] != '\0'; i++) {
-        // Check if the TX buffer is empty first
-        while(!(EUSCI_A0->IFG & EUSCI_A_IFG_TXIFG));
+void buttonSettled(Timer* timer);
+Timer debounceTimer = TIMER(buttonSettled);
 
-        // Send next character of message
-        EUSCI_A0->TXBUF = message[i];
-    }
-}
+void handleResponse(void) {
+    uint32_t now = millis();
 
-void sendRequest(void) {
-    if (!responseReady) {
-        printMessage(httpRequest);
+    // Ignore responses to any request but the one in flight, such as one that timed out
+    if (!requestAnswers(buffer)) {
+        resetReceive();
+        return;
     }
-}
 
-void displayLCD(LCDField field){
-    JSONValue* value;
-    JSONValue* wind_dir;
-    char* format;
-    char charBuffer[] = "                ";
-
-    switch (field) {
-    case TEMP:
-        value = JSONGet(current, "temp_f");
-        format = "Temp: %8.3f F";
-        break;
-    case HUMIDITY:
-        value = JSONGet(current, "humidity");
-        format = "Humidity: %5.2f%%";
-        break;
-    case CONDITION:
-        value = JSONGet(current, "condition");
-        value = JSONGet(value, "text");
-        format = "%-16.*s";
-        break;
-    case WIND:
-        value = JSONGet(current, "wind_mph");
-        wind_dir = JSONGet(current, "wind_dir");
-        format = "Wind: %3.1f mph %-2.*s";
-    }
+    // Parse and render at full speed
+    clockBoost();
 
-    switch(value->type){
-    case NUMBER:
-        if (field == WIND) {
-            snprintf(charBuffer, sizeof(charBuffer), format, value->value.number, wind_dir->value.str->length, wind_dir->value.str->str);
-        } else {
-            snprintf(charBuffer, sizeof(charBuffer), format, value->value.number);
-        }
-        break;
-    case STRING:
-        snprintf(charBuffer, sizeof(charBuffer), format, value->value.str->length, value->value.str->str);
-        break;
-    default:
+    PROFILE_BEGIN(PROFILE_DESTROY);
+    destroyJSON(json);
+    PROFILE_END(PROFILE_DESTROY);
+
+    // Only the previous response held parser allocations, so they should all be gone
+    HEAP_ASSERT_EMPTY(HEAP_JSON);
+    HEAP_ASSERT_EMPTY(HEAP_ARRAY);
+    HEAP_ASSERT_EMPTY(HEAP_MAP);
+
+    PROFILE_BEGIN(PROFILE_PARSE);
+    json = parseJSON((const char*)buffer);
+    PROFILE_END(PROFILE_PARSE);
+    TRACE(TRACE_RESPONSE, strlen(buffer), json && json->type != JSONERR);
+
+    if (!json || json->type == JSONERR) {
+        destroyJSON(json);
+        json = NULL;
+        current = NULL;
+        requestFailed(now);
+        resetReceive();
         return;
     }
 
+    // Only a response that parses answers the request
+    bindResults(json);
+    requestComplete(now);
+
+    // Rotate to the next location that came back in the response
     int i;
-    for(i = 0; i < (sizeof(charBuffer)/sizeof(char)) - 1; i++){
-        printChar(charBuffer[i]);    // print format string plus value
+    for (i = 1; i <= locationCount; i++) {
+        int next = (site + i) % locationCount;
+        if (results[next].current) {
+            site = next;
+            break;
+        }
     }
-}
-
-inline void updateLCD(void) {
-    setCursorFirstLine();   // Set LCD cursor to start of first line
-    displayLCD(field1);
-    setCursorSecondLine();
-    displayLCD(field2);
-}
-
-void handleResponse(void) {
-    destroyJSON(json);
-    json = parseJSON(buffer);
-    if (!json) return;
 
-    current = JSONGet(json, "current");
+    // Format the fields that changed now so the button only has to copy cached lines
+    current = results[site].current;
+    if (current) {
+        PROFILE_BEGIN(PROFILE_PUBLISH);
+        publish(site, current);
+        PROFILE_END(PROFILE_PUBLISH);
+        if (renderPages()) showPages();
+    } else {
+        streamAbort();
+    }
 
-    updateLCD();
+    // Show values from the location expected next while its response arrives
+    if (locationCount > 0) streamTarget((site + 1) % locationCount);
 
     responseReady = false;
 }
@@ -120,15 +114,73 @@ void initSW(void){
     P1->SEL1 &= ~BIT4;
 
     // set pin directions to input
-    P1->DIR & ~BIT4;
+    P1->DIR &= ~BIT4;
 
     // set internal resistors for pull-up and enable them
     P1->OUT |= BIT4;
     P1->REN |= BIT4;
 
     // Enable port interrupts with high-to-low transition
-//    P1->IES |= BIT4;    // set high to low transition
-//    P1->IE |= BIT4;     // enable interrupt
+    P1->IES |= BIT4;    // set high to low transition
+    P1->IFG &= ~BIT4;   // clear any edge from configuring the pin
+    P1->IE |= BIT4;     // enable interrupt
+
+    NVIC->ISER[1] = 1 << (PORT1_IRQn & 31);
+}
+
+// Cycles the pages on a button press
+void buttonTask(void) {
+    cycleLCD();
+    showPages();
+    timerStart(&debounceTimer, BUTTON_DEBOUNCE, 0);
+}
+
+// Listens for the next press once the button has been released and stopped bouncing
+void buttonSettled(Timer* timer) {
+    if (!(P1->IN & BIT4)) {
+        timerStart(&debounceTimer, BUTTON_DEBOUNCE, 0);
+        return;
+    }
+    P1->IFG &= ~BIT4;
+    P1->IE |= BIT4;
+}
+
+// Moves bytes between the UART and the channels, then serves each channel
+void linkTask(void) {
+    frameProcess();
+    controlProcess();
+    traceProcess();     // Continue a trace dump as the telemetry queue drains
+    requestReceive();
+    if (responseReady) taskPost(TASK_PARSE);
+
+    // Show values published while a response is still arriving
+    taskPost(TASK_RENDER);
+
+    // Come back for bytes left behind a full channel, unless they wait on the parse, or the rest of a trace dump
+    if ((uartAvailable() > 0 && !responseReady) || traceDumping()) taskPost(TASK_LINK);
+}
+
+void parseTask(void) {
+    handleResponse();
+
+    // Receive whatever arrived behind the response
+    taskPost(TASK_LINK);
+}
+
+void renderTask(void) {
+    if (renderPages()) showPages();
+
+    // Scroll long text
+    marqueeProcess();
+}
+
+// Button interrupt, off until buttonSettled has debounced the press
+void PORT1_IRQHandler(void) {
+    if (P1->IFG & BIT4) {
+        P1->IE &= ~BIT4;
+        P1->IFG &= ~BIT4;
+        eventPost(EVENT_BUTTON);
+    }
 }
 
 /**
@@ -138,51 +190,24 @@ int main(void) {
     // Stop Watchdog timer
     WDT_A->CTL = WDT_A_CTL_PW | WDT_A_CTL_HOLD;
 
-    buffer = malloc(BUFFER_SIZE * sizeof(char));
-
     // Config stuff
     configHFXT();
     configLFXT();
+    initTimebase(CLK_FREQUENCY);    // Time source for request scheduling and timeouts
+    initEvents();
+    initTimers(ACLK_FREQUENCY);     // Software timers for polling, timeouts, debounce and the marquee
+    initClock();                    // SMCLK down to SMCLK_FREQUENCY, MCLK idles between responses
+    initProfile();
     initSW();
-    configLCD(CLK_FREQUENCY);
+    configLCD(SMCLK_FREQUENCY);
     initLCD();
-
-    // Configure UART pins
-    P1->SEL0 |= BIT2 | BIT3;
-    P1->SEL1 &= ~(BIT2 | BIT3);
-
-    /* Configure UART
-     *  Asynchronous UART mode, 8O1 (8-bit data, even parity, 1 stop bit),
-     *  LSB first, SMCLK clock source
-     */
-    EUSCI_A0->CTLW0 |= EUSCI_A_CTLW0_SWRST;     // Put eUSCI in reset
-    EUSCI_A0->CTLW0 = EUSCI_A_CTLW0_SSEL__SMCLK // SMCLK source
-                // | EUSCI_A_CTLW0_PEN             // Parity enable
-                | EUSCI_A_CTLW0_SWRST;          // Remain in reset
-
-    /* Baud Rate calculation
-     * Refer to Section 24.3.10 of Technical Reference manual
-     * BRCLK = 48000000, BR = 38400
-     * N = 1250
-     */
-    EUSCI_A0->BRW = 78;
-
-    // Configure baud clock modulation in eUSCI_A0 modulation control register
-    // EUSCI_A0->MCTLW |= 0x0021 & 0x00FF;
-    EUSCI_A0->MCTLW = (2 << EUSCI_A_MCTLW_BRF_OFS)
-            | (0 << EUSCI_A_MCTLW_BRS_OFS)
-            | EUSCI_A_MCTLW_OS16;
-
-    EUSCI_A0->CTLW0 &= ~EUSCI_A_CTLW0_SWRST;    // Initialize eUSCI
-    EUSCI_A0->IFG &= ~EUSCI_A_IFG_RXIFG;        // Clear eUSCI RX interrupt flag
-    EUSCI_A0->IE |= EUSCI_A_IE_RXIE;            // Enable USCI_A0 RX interrupt
+    configUART(SMCLK_FREQUENCY);
+    uartWakeOn(FRAME_END);
+    initRequest();
 
     // Enable global interrupt
     __enable_irq();
 
-    // Enable eUSCIA0 interrupt in NVIC module
-    NVIC->ISER[0] = (1 << EUSCIA0_IRQn);
-
     // Optional tests
     #ifdef TEST
 
@@ -195,86 +220,71 @@ int main(void) {
     // Test JSON parser
     testParser();
 
-    #endif
+    // Request builder tests
+    testRequest();
 
-    sendRequest();
+    // Baud rate tests
+    testBaud();
 
-    // Configure timer to send another request every 5 seconds
-    TIMER_A0->CCR[0] = TIMER_TICKS;
-    TIMER_A0->CTL = TIMER_A_CTL_MC__UP
-                | TIMER_A_CTL_SSEL__ACLK
-                | TIMER_A_CTL_IE
-                | TIMER_A_CTL_CLR;
+    // Framing tests
+    testFrame();
 
-    NVIC->ISER[0] |=  1 << TA0_N_IRQn;
+    // Formatter tests and benchmark
+    testFormat();
 
-    __enable_irq(); // Enable global interrupt
+    // Change notification tests
+    testNotify();
 
-    int delay;
+    // Streaming scanner tests
+    testStream();
 
-    sendRequest();
+    // Profiler overhead
+    testProfile();
 
-    while (true) {
-        if (responseReady) {
-            handleResponse();
-        }
+    // Trace records
+    testTrace();
 
-        // Handle button press
-        if (!(P1->IN & BIT4)) {
-            // create function in lcd.c to cycle info on LCD screen
-            cycleLCD();
-            updateLCD();
-            // lazy debounce for now
-            for (delay = 0; delay < 5000; delay++);
-            // wait for S2 released
-            while (((P1->IN & 0x0010) >> 4) == 0);
-            // debounce
-            for (delay = 0; delay < 5000; delay++);
-        }
-    }
-}
+    // Heap accounting
+    testHeap();
 
-// UART interrupt service routine
-void EUSCIA0_IRQHandler(void) {
-    if (EUSCI_A0->IFG & EUSCI_A_IFG_RXIFG) {
-        // Note that reading RX buffer clears the flag and removes value from buffer
-        char input = EUSCI_A0->RXBUF;
-
-        // If the buffer is full or there is already a response pending, don't do anything
-        if (responseReady || buffer_i >= BUFFER_SIZE) return;
-
-        // Set flag if input is a NUL character
-        if (input == '\0') {
-            buffer[buffer_i] = '\0';
-            buffer_i = 0;
-            nl_cnt = 0;
-            responseReady = true;
-            return;
-        }
+    // Stack watermark
+    testStack();
 
-        // Drop HTTP response headers and only save body
-        if (nl_cnt < 2) {
-            switch (input) {
-            case '\n':
-                nl_cnt++;
-            case '\r':
-                break;
-            default:
-                nl_cnt = 0;
-            }
-        } else {
-            buffer[buffer_i] = input;
-            buffer_i++;
-        }
-    }
-}
+    // Cycles of the code run from SRAM
+    testRamfunc();
+
+    // Timebase across clock switches
+    testClock();
+
+    // Event posting and wake latency
+    testEvents();
 
-// Timer interrupt to send request every 5 s
-void TA0_N_IRQHandler(void) {
-    // Not necessary to check which flag is set because only one IRQ mapped to this interrupt vector
-    sendRequest();
+    // Task priorities
+    testTasks();
 
-    // Clear timer compare flag in TA3CCTL0
-    TIMER_A0->CTL &= ~TIMER_A_CTL_IFG;
+    // Timer wheel expiries and wakes
+    testTimers();
+
+    #endif
+
+    // Render pages as readings change, and scroll text too long for the display
+    configDisplay();
+    streamTarget((site + 1) % locationCount);
+
+    __enable_irq(); // Enable global interrupt
+
+    // Switch the link to a faster rate if the forwarder supports it, before any requests go out
+    negotiateBaud(UART_TARGET_BAUD);
+    uint32_t start = millis();
+    while (baudPending() && millis() - start < NEGOTIATE_TIMEOUT) {
+        frameProcess();
+        controlProcess();
+    }
+    cancelBaud();
 
+    // Serve the link and start the timers, then run tasks as events make them ready
+    taskPost(TASK_LINK);
+    taskPost(TASK_TIMER);
+    taskPost(TASK_RENDER);
+    taskSchedule();
 }
@@ -1,20 +1,15 @@
 #include "map.h"
+#include "heap.h"
+#include "ramfunc.h"
 #include <string.h>
 
-size_t allocated_map = 0;
-
-#define MALLOC(size) \
-    ({  allocated_map += size; \
-        malloc(size); })
-
-#define FREE(ptr) \
-    ({  allocated_map -= sizeof(*(__typeof__(ptr)){NULL}); \
-        free(ptr); })
+#define MALLOC(size) heapAlloc(HEAP_MAP, size)
+#define FREE(ptr) heapFree(HEAP_MAP, ptr, sizeof(*(ptr)))
 
 #define MIN(a, b) (a < b ? a : b)
 
 // Returns the index at which two strings differ, or -1 if they're equal
-int strdiff(const char* fst, size_t lenFst, const char* snd, size_t lenSnd) {
+RAMFUNC int strdiff(const char* fst, size_t lenFst, const char* snd, size_t lenSnd) {
     int i;
     for (i = 0; i < MIN(lenFst, lenSnd); i++) {
         if (fst[i] != snd[i]) {
@@ -58,21 +53,67 @@ void destroyMap(Map* map, void (*freeValue)(void*)) {
         void* value;
         arrayForeach(map->value.tree, value, _i) {
             destroyMap(value, freeValue);
-            allocated_array -= sizeof(void*);
         }
 
-        allocated_array -= sizeof(map->value.tree->buffer);
-        free(map->value.tree->buffer);
-        allocated_array -= sizeof(map->value.tree);
-        free(map->value.tree);
+        // The children array came from newArray, so goes back to the array subsystem
+        Array* tree = map->value.tree;
+        heapFree(HEAP_ARRAY, tree->buffer, tree->capacity * sizeof(void*));
+        heapFree(HEAP_ARRAY, tree, sizeof(Array));
     }
     }
 
     FREE(map);
 }
 
+// Returns a new leaf holding value under the given prefix, or NULL
+static Map* newLeaf(const char* prefix, size_t prefixLen, void* value) {
+    Map* leaf = newMap();
+    if (!leaf) return NULL;
+
+    leaf->prefix = prefix;
+    leaf->prefixLen = prefixLen;
+    leaf->value.leaf = value;
+    return leaf;
+}
+
+// Splits the map at index i of its prefix into a child holding the new value and a child
+//  holding whatever the map held before. Everything is allocated before the map is touched,
+//  so on failure the map is as it was and the value still belongs to the caller
+static MapErr splitMap(Map* map, int i, const char* key, size_t keyLen, void* value) {
+    Map* childNew = newLeaf(&key[i], keyLen - i, value);
+    if (!childNew) return MAP_ALLOC_ERR;
+
+    // Child with old value, retaining any children
+    Map* childOld = newLeaf(&map->prefix[i], map->prefixLen - i, NULL);
+    if (!childOld) {
+        FREE(childNew);
+        return MAP_ALLOC_ERR;
+    }
+    childOld->type = map->type;
+    childOld->value = map->value;
+
+    Array* tree = newArray();
+    if (!tree || arrayAppend(tree, childNew) || arrayAppend(tree, childOld)) {
+        if (tree) {
+            heapFree(HEAP_ARRAY, tree->buffer, tree->capacity * sizeof(void*));
+            heapFree(HEAP_ARRAY, tree, sizeof(Array));
+        }
+        FREE(childOld);
+        FREE(childNew);
+        return ARRAY_ALLOC_ERR;
+    }
+
+    // Set the map to a tree with the two children
+    map->prefixLen = i;
+    map->type = TREE;
+    map->value.tree = tree;
+    return SUCCESS;
+}
+
 // Inserts a new key-value pair into the map
-MapErr mapInsert(Map* map, const char* key, size_t keyLen, void* value) {
+// A value already under the key is replaced and passed to freeValue
+// On failure the map is left as it was and value is not freed
+MapErr mapInsert(Map* map, const char* key, size_t keyLen, void* value, void (*freeValue)(void*)) {
     if (!map) return MAP_ALLOC_ERR;
 
     int i = strdiff(key, keyLen, map->prefix, map->prefixLen);
@@ -80,43 +121,18 @@ MapErr mapInsert(Map* map, const char* key, size_t keyLen, void* value) {
     switch (map->type) {
     case LEAF:
         if (i == -1) {
-            // If the key and prefix are equal, override the new value
+            // If the key and prefix are equal, override the old value
+            if (map->value.leaf != value) freeValue(map->value.leaf);
+            map->value.leaf = value;
+        } else if (mapIsEmpty(map)) {
+            // If the map is empty, it becomes a leaf for the key
+            // NOTE: does not copy strings for efficiency, so they must be freed by the caller
+            map->prefix = &key[i];
+            map->prefixLen = keyLen - i;
             map->value.leaf = value;
         } else {
             // Split the key and prefix at the given index
-            // NOTE: does not copy strings for efficiency, so they must be freed by the caller
-
-            // Child with new value
-            Map* childNew = newMap();
-            if (!childNew) return MAP_ALLOC_ERR;
-            childNew->prefix = &key[i];
-            childNew->prefixLen = keyLen - i;
-            childNew->value.leaf = value;
-
-            // If the map is empty, replace it with a new leaf node
-            if (mapIsEmpty(map)) {
-                *map = *childNew;
-                FREE(childNew);
-                return SUCCESS;
-            }
-
-            // Child with old value
-            Map* childOld = newMap();
-            if (!childOld) return MAP_ALLOC_ERR;
-            childOld->prefix = &map->prefix[i];
-            childOld->prefixLen = map->prefixLen - i;
-            childOld->value.leaf = map->value.leaf;
-
-            // Set the map to a tree with the two children
-            map->prefixLen = i;
-            map->type = TREE;
-            map->value.tree = newArray();
-            if (!map->value.tree) return ARRAY_ALLOC_ERR;
-
-            ArrayErr err = arrayAppend(map->value.tree, childNew);
-            if (err) return ARRAY_ALLOC_ERR;
-            err = arrayAppend(map->value.tree, childOld);
-            if (err) return ARRAY_ALLOC_ERR;
+            return splitMap(map, i, key, keyLen, value);
         }
         break;
     case TREE:
@@ -129,52 +145,29 @@ MapErr mapInsert(Map* map, const char* key, size_t keyLen, void* value) {
                 arrayForeach(map->value.tree, child, _i) {
                     if (key[i] == child->prefix[0]) {
                         // Once the matching prefix is found, call insert on the child
-                        return mapInsert(child, &key[i], keyLen - i, value);
+                        return mapInsert(child, &key[i], keyLen - i, value, freeValue);
                     }
                 }
             }
 
             // If a matching child was not found, insert a new child with the remainder of the key
-            Map* childNew = newMap();
+            Map* childNew = newLeaf(&key[i], keyLen - i, value);
             if (!childNew) return MAP_ALLOC_ERR;
-            childNew->prefix = &key[i];
-            childNew->prefixLen = keyLen - i;
-            childNew->value.leaf = value;
 
-            ArrayErr err = arrayAppend(map->value.tree, childNew);
-            if (err) return ARRAY_ALLOC_ERR;
+            if (arrayAppend(map->value.tree, childNew)) {
+                FREE(childNew);
+                return ARRAY_ALLOC_ERR;
+            }
         } else {
             // Otherwise, split the prefix like before, retaining the current map's children
-            Map* childNew = newMap();
-            if (!childNew) return MAP_ALLOC_ERR;
-            childNew->prefix = &key[i];
-            childNew->prefixLen = keyLen - i;
-            childNew->value.leaf = value;
-
-            // Child with old value, retaining children
-            Map* childOld = newMap();
-            if (!childOld) return MAP_ALLOC_ERR;
-            childOld->prefix = &map->prefix[i];
-            childOld->prefixLen = map->prefixLen - i;
-            childOld->type = TREE;
-            childOld->value.tree = map->value.tree;
-
-            // Set the map to a tree with the two children
-            map->prefixLen = i;
-            map->value.tree = newArray();
-            if (!map->value.tree) return ARRAY_ALLOC_ERR;
-
-            ArrayErr err = arrayAppend(map->value.tree, childNew);
-            if (err) return ARRAY_ALLOC_ERR;
-            err = arrayAppend(map->value.tree, childOld);
-            if (err) return ARRAY_ALLOC_ERR;
+            return splitMap(map, i, key, keyLen, value);
         }
     }
 
     return SUCCESS;
 }
 
-void* mapGet(const Map* map, const char* key, size_t keyLen) {
+RAMFUNC void* mapGet(const Map* map, const char* key, size_t keyLen) {
     if (map->type == LEAF) {
         return map->value.leaf;
     }
@@ -203,43 +196,49 @@ void testMap(void) {
     int* a = malloc(sizeof(int));
     *a = 1;
     const char* key1 = "romane";
-    MapErr err = mapInsert(map, key1, 6, a);
+    MapErr err = mapInsert(map, key1, 6, a, free);
     int* a_new = (int*)mapGet(map, key1, 6);
 
     int* b = malloc(sizeof(int));
     *b = 2;
-    err = mapInsert(map, "romanus", 7, b);
+    err = mapInsert(map, "romanus", 7, b, free);
     int* b_new = (int*)mapGet(map, "romanus", 7);
 
     int* c = malloc(sizeof(int));
     *c = 3;
-    err = mapInsert(map, "romulus", 7, c);
+    err = mapInsert(map, "romulus", 7, c, free);
     int* c_new = (int*)mapGet(map, "romulus", 7);
 
     int* d = malloc(sizeof(int));
     *d = 4;
-    err = mapInsert(map, "rubens", 6, d);
+    err = mapInsert(map, "rubens", 6, d, free);
     int* d_new = (int*)mapGet(map, "rubens", 6);
 
     int* e = malloc(sizeof(int));
     *e = 5;
-    err = mapInsert(map, "ruber", 5, e);
+    err = mapInsert(map, "ruber", 5, e, free);
     int* e_new = (int*)mapGet(map, "ruber", 5);
 
     int* f = malloc(sizeof(int));
     *f = 6;
-    err = mapInsert(map, "rubicon", 7, f);
+    err = mapInsert(map, "rubicon", 7, f, free);
     int* f_new = (int*)mapGet(map, "rubicon", 7);
 
     int* g = malloc(sizeof(int));
     *g = 7;
-    err = mapInsert(map, "rubicundus", 10, g);
+    err = mapInsert(map, "rubicundus", 10, g, free);
     int* g_new = (int*)mapGet(map, "rubicundus", 10);
 
     int* h = malloc(sizeof(int));
     *h = 8;
-    err = mapInsert(map, "roman", 5, h);
+    err = mapInsert(map, "roman", 5, h, free);
     int* h_new = (int*)mapGet(map, "roman", 5);
 
+    // A duplicate key replaces the value, freeing the old one
+    int* i = malloc(sizeof(int));
+    *i = 9;
+    err = mapInsert(map, "roman", 5, i, free);
+    int* i_new = (int*)mapGet(map, "roman", 5);
+
     destroyMap(map, free);
 }
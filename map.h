@@ -37,7 +37,12 @@ void destroyMap(Map* map, void (*freeValue)(void*));
 
 bool mapIsEmpty(Map* map);
 
-MapErr mapInsert(Map* map, const char* key, size_t keyLen, void* value);
+/*
+ * Inserts value under key, which is not copied so must outlive the map. A
+ *  value already under the key is replaced and passed to freeValue. On failure
+ *  the map is left as it was and value still belongs to the caller.
+ */
+MapErr mapInsert(Map* map, const char* key, size_t keyLen, void* value, void (*freeValue)(void*));
 
 void* mapGet(const Map* map, const char* key, size_t keyLen);
 
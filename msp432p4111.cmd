@@ -72,8 +72,9 @@ MEMORY
 /* A heap size of 1024 bytes is recommended when you plan to use printf()    */
 /* for debug output to the console window.                                   */
 /*                                                                           */
---heap_size=2048
-/* --stack_size=512                                                          */
+--heap_size=4096
+/* Worst case stack use is checked against this by tools/stackreport.py     */
+--stack_size=2048
 /* --library=rtsv7M4_T_le_eabi.lib                                           */
 
 /* Section allocation in memory */
@@ -0,0 +1,274 @@
+#include "notify.h"
+#include "trace.h"
+#include <string.h>
+
+typedef struct {
+    const char* name;
+    const char* numberPath;
+    const char* textPath;
+} TopicPaths;
+
+#define TOPIC_ENTRY(topic, name, numberPath, textPath) {name, numberPath, textPath},
+
+const TopicPaths topicPaths[NUM_TOPICS] = {
+    TOPICS(TOPIC_ENTRY)
+};
+
+typedef struct {
+    uint32_t topics;
+    Subscriber callback;
+} Subscription;
+
+NotifyStats notifyStats;
+
+Subscription subscriptions[MAX_SUBSCRIBERS];
+int subscriptionCount = 0;
+
+// Readings from the last published response of every location slot
+Reading snapshot[MAX_LOCATIONS][NUM_TOPICS];
+int shown = 0;              // Slot whose readings subscribers see
+
+// Snapshot of the slot from before the first value of a response still being
+//  received, the slot shown then, and the topics that response has updated so
+//  far. Only one response arrives at a time
+Reading checkpoint[NUM_TOPICS];
+int checkpointSlot = 0;
+int checkpointShown = 0;
+bool provisional = false;
+uint32_t touched = 0;
+
+JSONValue* resolvePath(JSONValue* value, const char* path) {
+    if (!path) return NULL;
+
+    while (value && value->type == OBJECT) {
+        const char* end = strchr(path, '.');
+        size_t length = end ? end - path : strlen(path);
+        value = mapGet(value->value.object, path, length);
+        if (!end) return value;
+        path = end + 1;
+    }
+    return NULL;
+}
+
+// Fills in whichever of a reading's values are given and of the right type
+void readValues(Reading* reading, JSONValue* number, JSONValue* text) {
+    if (number && number->type == NUMBER) {
+        reading->hasNumber = true;
+        reading->number = number->value.number;
+    }
+    if (text && text->type == STRING) {
+        // JSON strings point into the receive buffer, so keep a copy
+        size_t length = text->value.str->length;
+        if (length > READING_TEXT_SIZE - 1) length = READING_TEXT_SIZE - 1;
+        reading->hasText = true;
+        memcpy(reading->text, text->value.str->str, length);
+        memset(&reading->text[length], 0, READING_TEXT_SIZE - length);
+    }
+}
+
+void decodeTopic(Topic topic, JSONValue* current, Reading* reading) {
+    memset(reading, 0, sizeof(Reading));
+    readValues(reading,
+            resolvePath(current, topicPaths[topic].numberPath),
+            resolvePath(current, topicPaths[topic].textPath));
+}
+
+// Readings are zero filled past their text, so they can be compared whole
+inline bool sameReading(const Reading* a, const Reading* b) {
+    return memcmp(a, b, sizeof(Reading)) == 0;
+}
+
+// Calls the topic's subscribers once its new reading is in the shown snapshot
+void notifyTopic(Topic topic, const Reading* old) {
+    int i;
+    for (i = 0; i < subscriptionCount; i++) {
+        if (subscriptions[i].topics & TOPIC_BIT(topic)) {
+            subscriptions[i].callback(topic, old, &snapshot[shown][topic]);
+            notifyStats.notifications++;
+        }
+    }
+}
+
+// Counts a topic that changed within its own slot, notifying if that slot is shown
+void changeTopic(int slot, Topic topic, const Reading* old) {
+    TRACE(TRACE_TOPIC, topic, slot);
+    notifyStats.changes++;
+    if (slot == shown) notifyTopic(topic, old);
+}
+
+// Replaces a single reading, notifying if it changed
+void updateTopic(int slot, Topic topic, const Reading* reading) {
+    if (sameReading(&snapshot[slot][topic], reading)) return;
+
+    Reading old = snapshot[slot][topic];
+    snapshot[slot][topic] = *reading;
+    changeTopic(slot, topic, &old);
+}
+
+// Shows another slot's readings, notifying the topics that read differently there
+void showSlot(int slot) {
+    if (slot == shown) return;
+
+    int before = shown;
+    shown = slot;
+    notifyStats.switches++;
+
+    Topic topic;
+    for (topic = (Topic)0; topic < NUM_TOPICS; topic++) {
+        if (!sameReading(&snapshot[before][topic], &snapshot[slot][topic])) {
+            notifyTopic(topic, &snapshot[before][topic]);
+        }
+    }
+}
+
+bool subscribe(uint32_t topics, Subscriber subscriber) {
+    if (subscriptionCount >= MAX_SUBSCRIBERS) return false;
+
+    subscriptions[subscriptionCount].topics = topics;
+    subscriptions[subscriptionCount].callback = subscriber;
+    subscriptionCount++;
+    return true;
+}
+
+void publish(int slot, JSONValue* current) {
+    Reading previous[NUM_TOPICS];
+    Topic topic;
+
+    // Update the slot's whole snapshot first, so subscribers see every new reading
+    memcpy(previous, snapshot[slot], sizeof(previous));
+    for (topic = (Topic)0; topic < NUM_TOPICS; topic++) {
+        decodeTopic(topic, current, &snapshot[slot][topic]);
+    }
+    notifyStats.published++;
+
+    // The complete response supersedes anything published from it early
+    provisional = false;
+
+    for (topic = (Topic)0; topic < NUM_TOPICS; topic++) {
+        if (!sameReading(&previous[topic], &snapshot[slot][topic])) {
+            changeTopic(slot, topic, &previous[topic]);
+        }
+    }
+    showSlot(slot);
+}
+
+void publishValue(int slot, const char* path, JSONValue* value) {
+    // A response for another slot replaces one that never completed
+    if (provisional && slot != checkpointSlot) rollback();
+
+    if (!provisional) {
+        memcpy(checkpoint, snapshot[slot], sizeof(checkpoint));
+        checkpointSlot = slot;
+        checkpointShown = shown;
+        provisional = true;
+        touched = 0;
+    }
+
+    // Values arriving early show their location early
+    showSlot(slot);
+
+    Topic topic;
+    for (topic = (Topic)0; topic < NUM_TOPICS; topic++) {
+        bool number = topicPaths[topic].numberPath && strcmp(path, topicPaths[topic].numberPath) == 0;
+        bool text = topicPaths[topic].textPath && strcmp(path, topicPaths[topic].textPath) == 0;
+        if (!number && !text) continue;
+
+        // Build the reading up from nothing, as publish would from this response
+        Reading reading;
+        if (touched & TOPIC_BIT(topic)) {
+            reading = snapshot[slot][topic];
+        } else {
+            memset(&reading, 0, sizeof(Reading));
+        }
+        readValues(&reading, number ? value : NULL, text ? value : NULL);
+        touched |= TOPIC_BIT(topic);
+
+        updateTopic(slot, topic, &reading);
+        notifyStats.early++;
+    }
+}
+
+void rollback(void) {
+    if (!provisional) return;
+    provisional = false;
+
+    Topic topic;
+    for (topic = (Topic)0; topic < NUM_TOPICS; topic++) {
+        updateTopic(checkpointSlot, topic, &checkpoint[topic]);
+    }
+    showSlot(checkpointShown);
+    notifyStats.rollbacks++;
+    TRACE(TRACE_ROLLBACK, 0, 0);
+}
+
+inline const Reading* currentReading(Topic topic) {
+    return &snapshot[shown][topic];
+}
+
+inline int currentSlot(void) {
+    return shown;
+}
+
+inline const char* topicName(Topic topic) {
+    return topicPaths[topic].name;
+}
+
+int testCalls = 0;
+Topic testTopic = TOPIC_NONE;
+
+void testSubscriber(Topic topic, const Reading* old, const Reading* now) {
+    testCalls++;
+    testTopic = topic;
+}
+
+void testNotify(void) {
+    const char* first = "{\"temp_f\":44.4,\"humidity\":58,\"condition\":{\"text\":\"Partly cloudy\",\"code\":1003}}";
+    const char* second = "{\"temp_f\":45.0,\"humidity\":58,\"condition\":{\"text\":\"Partly cloudy\",\"code\":1003}}";
+
+    subscribe(TOPIC_BIT(TOPIC_TEMP) | TOPIC_BIT(TOPIC_CONDITION), testSubscriber);
+
+    // Everything is new the first time, but only subscribed topics call back
+    JSONValue* json = parseJSON(first);
+    publish(0, json);
+    destroyJSON(json);
+    int calls = testCalls;          // Should be 2
+
+    // Only the temperature changed
+    json = parseJSON(second);
+    publish(0, json);
+    destroyJSON(json);
+    calls = testCalls - calls;      // Should be 1, for TOPIC_TEMP
+    Topic topic = testTopic;
+
+    // Nothing changed
+    json = parseJSON(second);
+    publish(0, json);
+    destroyJSON(json);
+    calls = testCalls;              // Should still be 3
+
+    float temp = currentReading(TOPIC_TEMP)->number;    // Should be 45.0
+
+    // A value published early is undone if its response fails
+    JSONValue* value = parseJSONValue("46.5");
+    publishValue(0, "temp_f", value);
+    destroyJSON(value);
+    temp = currentReading(TOPIC_TEMP)->number;          // Should be 46.5
+    rollback();
+    temp = currentReading(TOPIC_TEMP)->number;          // Should be 45.0 again
+    calls = testCalls;                                  // Should be 5
+
+    // Another location is compared with its own last readings, not the one shown
+    json = parseJSON(first);
+    publish(1, json);
+    destroyJSON(json);
+    calls = testCalls - calls;      // Should be 1, TOPIC_TEMP reads 44.4 rather than 45.0
+    uint32_t changes = notifyStats.changes;
+    json = parseJSON(first);
+    publish(1, json);
+    destroyJSON(json);
+    uint32_t repeated = notifyStats.changes - changes;  // Should be 0
+    json = parseJSON(second);
+    publish(0, json);
+    destroyJSON(json);
+    uint32_t back = notifyStats.changes - changes;      // Should still be 0, slot 0 already read 45.0
+}
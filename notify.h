@@ -0,0 +1,141 @@
+/*
+ * notify.h
+ *
+ *      Description: Change notification for the decoded weather fields. Every
+ *                   tracked field of a location's current conditions is a
+ *                   topic, decoded into a Reading that holds a number, a text
+ *                   or both:
+ *
+ *                   X(topic, name, numberPath, textPath)
+ *
+ *                   Paths are dot separated keys under "current", or NULL.
+ *
+ *                   Every location slot keeps a snapshot of its own last
+ *                   response, and each published response is compared topic
+ *                   by topic with the snapshot of its slot. Subscribers see
+ *                   the readings of the slot published last, and are called
+ *                   only for the topics that read differently, with the old
+ *                   and new readings. That is either a change within the
+ *                   slot, or a topic that differs between the location shown
+ *                   before and the one shown now.
+ *
+ *                   Values can also be published one at a time while their
+ *                   response is still arriving. They are provisional until
+ *                   the whole response is published, and rollback restores
+ *                   the slot's snapshot, and the slot shown, from before them
+ *                   if it never is.
+ *
+ *      Author: gibbonec
+ */
+
+#ifndef NOTIFY_H_
+#define NOTIFY_H_
+
+#include "json.h"
+#include "request.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TOPICS(X) \
+    X(TOPIC_TEMP,      "temp",      "temp_f",         NULL) \
+    X(TOPIC_HUMIDITY,  "humidity",  "humidity",       NULL) \
+    X(TOPIC_CONDITION, "condition", "condition.code", "condition.text") \
+    X(TOPIC_WIND,      "wind",      "wind_mph",       NULL) \
+    X(TOPIC_WIND_DIR,  "wind_dir",  NULL,             "wind_dir")
+
+#define TOPIC_ENUM(topic, name, numberPath, textPath) topic,
+
+typedef enum {
+    TOPIC_NONE = -1,
+    TOPICS(TOPIC_ENUM)
+    NUM_TOPICS,
+} Topic;
+
+#define TOPIC_BIT(topic) ((topic) == TOPIC_NONE ? 0 : 1ul << (topic))
+#define ALL_TOPICS ((1ul << NUM_TOPICS) - 1)
+
+#define READING_TEXT_SIZE 40    // Longest text kept, including the NUL
+#define MAX_SUBSCRIBERS 4
+
+typedef struct {
+    bool hasNumber;
+    bool hasText;
+    float number;
+    char text[READING_TEXT_SIZE];
+} Reading;
+
+/*
+ * Called for every subscribed topic that changed, after the snapshot has been
+ *  updated, so currentReading returns the new readings of every topic.
+ */
+typedef void (*Subscriber)(Topic topic, const Reading* old, const Reading* now);
+
+typedef struct {
+    uint32_t published;     // Responses published
+    uint32_t changes;       // Topics that changed from their location's last readings
+    uint32_t switches;      // Times the readings shown moved to another location
+    uint32_t notifications; // Subscriber calls
+    uint32_t early;         // Values published before their response completed
+    uint32_t rollbacks;     // Responses whose early values were rolled back
+} NotifyStats;
+
+extern NotifyStats notifyStats;
+
+/*
+ * Calls the subscriber for changes to any topic in the mask of TOPIC_BITs.
+ *  Returns false if there are already MAX_SUBSCRIBERS.
+ */
+bool subscribe(uint32_t topics, Subscriber subscriber);
+
+/*
+ * Decodes every topic from the current conditions of the location in the given
+ *  slot, shows that slot, and notifies subscribers of the topics that read
+ *  differently.
+ */
+void publish(int slot, JSONValue* current);
+
+/*
+ * Publishes a single value for a slot, at a dot separated path under
+ *  "current", from a response still being received. Subscribers are notified
+ *  for any topic the value changed, as for publish.
+ */
+void publishValue(int slot, const char* path, JSONValue* value);
+
+/*
+ * Restores the readings, and the slot shown, from before any values published
+ *  since the last publish, notifying subscribers of the topics that change back.
+ */
+void rollback(void);
+
+/*
+ * Returns the reading of a topic in the slot shown, from its last published
+ *  response, or the provisional reading if values have been published since.
+ */
+const Reading* currentReading(Topic topic);
+
+/*
+ * Returns the slot whose readings currentReading returns.
+ */
+int currentSlot(void);
+
+/*
+ * Returns the name of a topic, for reports.
+ */
+const char* topicName(Topic topic);
+
+/*
+ * Follows a dot separated path of keys from an object, or returns NULL.
+ */
+JSONValue* resolvePath(JSONValue* value, const char* path);
+
+void testNotify(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NOTIFY_H_ */
@@ -0,0 +1,79 @@
+#include "profile.h"
+#include <string.h>
+
+#define PROFILE_NAME(scope, name) name,
+
+const char* const profileNames[NUM_PROFILE_SCOPES] = {
+    PROFILE_SCOPES(PROFILE_NAME)
+};
+
+ProfileStats profileStats[NUM_PROFILE_SCOPES];
+uint32_t profileCost = 0;
+
+#define COST_RUNS 16
+
+// Times empty scopes, keeping the fastest so an interrupt doesn't count
+void measureCost(void) {
+    int i;
+    profileCost = UINT32_MAX;
+    for (i = 0; i < COST_RUNS; i++) {
+        uint32_t start = profileNow();
+        {
+            PROFILE_BEGIN(PROFILE_PARSE);
+            PROFILE_END(PROFILE_PARSE);
+        }
+        uint32_t cost = profileNow() - start;
+        if (cost < profileCost) profileCost = cost;
+    }
+}
+
+void initProfile(void) {
+#ifdef __MSP432P4111__
+    // Enable the DWT cycle counter
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+    measureCost();
+    profileClear();
+}
+
+void profileClear(void) {
+    int i;
+    memset(profileStats, 0, sizeof(profileStats));
+    for (i = 0; i < NUM_PROFILE_SCOPES; i++) {
+        profileStats[i].min = UINT32_MAX;
+    }
+}
+
+uint32_t profileCount(ProfileScope scope) {
+    uint32_t count = 0;
+    int i;
+    for (i = 0; i < PROFILE_BUCKETS; i++) {
+        count += profileStats[scope].histogram[i];
+    }
+    return count;
+}
+
+inline const char* profileName(ProfileScope scope) {
+    return profileNames[scope];
+}
+
+void testProfile(void) {
+    int i;
+    initProfile();
+
+    // Cost of an empty scope, as seen by the scope itself and from outside.
+    //  Check the counts here
+    uint32_t start = profileNow();
+    for (i = 0; i < 100; i++) {
+        PROFILE_BEGIN(PROFILE_PARSE);
+        PROFILE_END(PROFILE_PARSE);
+    }
+    uint32_t perScope = (profileNow() - start) / 100;
+    uint32_t inside = profileStats[PROFILE_PARSE].min;
+    uint32_t count = profileCount(PROFILE_PARSE);              // Should be 100
+    uint32_t cost = profileCost;                                // Should be near perScope
+
+    profileClear();
+}
@@ -0,0 +1,127 @@
+/*
+ * profile.h
+ *
+ *      Description: Cycle counting profiler for hot paths. A scope is timed by
+ *                   bracketing it with PROFILE_BEGIN and PROFILE_END, which
+ *                   read the DWT cycle counter on the device, or a nanosecond
+ *                   clock in host builds. Every scope keeps its count, min,
+ *                   max, total and a log2 histogram in static storage:
+ *
+ *                   X(scope, name)
+ *
+ *                   Scopes stay compiled in. initProfile measures what a
+ *                   begin and end pair costs into profileCost, which PROFILE
+ *                   reports with the scopes. Durations are
+ *                   32 bit, so a scope must be shorter than 2^32 cycles,
+ *                   about 89 s at 48 MHz.
+ *
+ *                   DWT counts MCLK cycles, which the clock policy of
+ *                   clock.h runs at 48 MHz boosted and 12 MHz idle, so a
+ *                   scope's stats mix the two unless it only runs in one
+ *                   state. A cycle idle is 4 times as long.
+ *                   profileCost is measured boosted, as initProfile runs
+ *                   straight after initClock.
+ *
+ *      Author: gibbonec
+ */
+
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#include <stdint.h>
+
+#ifdef __MSP432P4111__
+#include "msp.h"
+#else
+#include <time.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PROFILE_SCOPES(X) \
+    X(PROFILE_PARSE,    "parse") \
+    X(PROFILE_DESTROY,  "destroy") \
+    X(PROFILE_PUBLISH,  "publish") \
+    X(PROFILE_RENDER,   "render") \
+    X(PROFILE_SHOW,     "show") \
+    X(PROFILE_UART_ISR, "uart_isr") \
+    X(PROFILE_LCD_ISR,  "lcd_isr")
+
+#define PROFILE_ENUM(scope, name) scope,
+
+typedef enum {
+    PROFILE_SCOPES(PROFILE_ENUM)
+    NUM_PROFILE_SCOPES,
+} ProfileScope;
+
+#define PROFILE_BUCKETS 32  // Bucket b counts durations of 2^b up to 2^(b+1) - 1 cycles
+
+// The count is the sum of the histogram, so recording doesn't keep it separately
+typedef struct {
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+    uint32_t histogram[PROFILE_BUCKETS];
+} ProfileStats;
+
+extern ProfileStats profileStats[NUM_PROFILE_SCOPES];
+extern uint32_t profileCost;    // Fewest cycles an empty scope took, timed from outside
+
+// Time in cycles on the device, or nanoseconds on the host
+static inline uint32_t profileNow(void) {
+#ifdef __MSP432P4111__
+    return DWT->CYCCNT;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)now.tv_sec * 1000000000u + now.tv_nsec;
+#endif
+}
+
+static inline void profileRecord(ProfileScope scope, uint32_t cycles) {
+    ProfileStats* stats = &profileStats[scope];
+#ifdef __MSP432P4111__
+    int bucket = 31 - __CLZ(cycles | 1);
+#else
+    int bucket = 31 - __builtin_clz(cycles | 1);
+#endif
+
+    stats->total += cycles;
+    if (cycles < stats->min) stats->min = cycles;
+    if (cycles > stats->max) stats->max = cycles;
+    stats->histogram[bucket]++;
+}
+
+/*
+ * Times the code between PROFILE_BEGIN and the PROFILE_END of the same scope,
+ *  which must be in the same block.
+ */
+#define PROFILE_BEGIN(scope) uint32_t profileStart_##scope = profileNow()
+#define PROFILE_END(scope) profileRecord(scope, profileNow() - profileStart_##scope)
+
+/*
+ * Starts the cycle counter, measures profileCost and clears every scope.
+ */
+void initProfile(void);
+
+void profileClear(void);
+
+/*
+ * Returns the number of times a scope was recorded.
+ */
+uint32_t profileCount(ProfileScope scope);
+
+/*
+ * Returns the name of a scope, for reports.
+ */
+const char* profileName(ProfileScope scope);
+
+void testProfile(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PROFILE_H_ */
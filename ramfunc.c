@@ -0,0 +1,63 @@
+#include "ramfunc.h"
+#include "json.h"
+#include "uart.h"
+#include "profile.h"
+
+#define RAMFUNC_RUNS 8      // Receive path runs, well under RX_HIGH_WATER so the sender isn't paused
+
+#ifdef __MSP432P4111__
+#define BANK0_BUFFERS (FLCTL_A_BANK0_RDCTL_BUFI | FLCTL_A_BANK0_RDCTL_BUFD)
+#define BANK1_BUFFERS (FLCTL_A_BANK1_RDCTL_BUFI | FLCTL_A_BANK1_RDCTL_BUFD)
+#endif
+
+// Cycles to parse the example response
+uint32_t benchParse(void) {
+    uint32_t start = profileNow();
+    JSONValue* json = parseJSON(exampleResponse);
+    uint32_t cycles = profileNow() - start;
+    destroyJSON(json);
+    return cycles;
+}
+
+// Cycles to look a reading up in the example response
+uint32_t benchLookup(JSONValue* json) {
+    uint32_t start = profileNow();
+    JSONGet(JSONGet(JSONGet(json, "current"), "condition"), "text");
+    return profileNow() - start;
+}
+
+void testRamfunc(void) {
+    int i;
+
+    // Check the cycle counts here, against a build with NO_RAMFUNC
+    uint32_t parseCycles = benchParse();
+    JSONValue* json = parseJSON(exampleResponse);
+    uint32_t lookupCycles = benchLookup(json);
+
+    // Receive path, minus interrupt entry and exit, on whatever is in RX buffer.
+    //  Run with interrupts masked and leave the ring and stats as they were
+    UARTStats stats = uartStats;
+    __disable_irq();
+    uint32_t start = profileNow();
+    for (i = 0; i < RAMFUNC_RUNS; i++) {
+        receiveByte();
+    }
+    uint32_t receiveCycles = (profileNow() - start) / RAMFUNC_RUNS;
+    __enable_irq();
+    uartFlush();
+    uartStats = stats;
+
+#ifdef __MSP432P4111__
+    // Again without the flash read buffers, as the code left in flash ran before they were enabled
+    uint32_t bank0 = FLCTL_A->BANK0_RDCTL;
+    uint32_t bank1 = FLCTL_A->BANK1_RDCTL;
+    FLCTL_A->BANK0_RDCTL = bank0 & ~BANK0_BUFFERS;
+    FLCTL_A->BANK1_RDCTL = bank1 & ~BANK1_BUFFERS;
+    uint32_t unbufferedParseCycles = benchParse();
+    uint32_t unbufferedLookupCycles = benchLookup(json);
+    FLCTL_A->BANK0_RDCTL = bank0;
+    FLCTL_A->BANK1_RDCTL = bank1;
+#endif
+
+    destroyJSON(json);
+}
@@ -0,0 +1,45 @@
+/*
+ * ramfunc.h
+ *
+ *      Description: Runs hot code from SRAM. At 48 MHz flash needs 3 wait
+ *                   states, which the read buffers only partly hide, while
+ *                   SRAM_CODE, the code bus alias of SRAM, has none. RAMFUNC
+ *                   puts a function in .TI.ramfunc, which msp432p4111.cmd
+ *                   loads in flash and runs from SRAM_CODE. The boot routine
+ *                   copies it through the BINIT table before main.
+ *
+ *                   SRAM is 16 MB away from flash, past the reach of a BL,
+ *                   so the linker calls between the two through trampolines.
+ *                   Helpers a RAMFUNC calls in its loop should be RAMFUNCs
+ *                   too, and so should their other callers, as the TI
+ *                   compiler only inlines with the optimizer on.
+ *
+ *                   Build with NO_RAMFUNC to run everything from flash, for
+ *                   testRamfunc to compare against.
+ *
+ *      Author: gibbonec
+ */
+
+#ifndef RAMFUNC_H_
+#define RAMFUNC_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__MSP432P4111__) && !defined(NO_RAMFUNC)
+#define RAMFUNC __attribute__((ramfunc))
+#else
+#define RAMFUNC
+#endif
+
+/*
+ * Benchmarks the parser, a lookup and the UART receive path in cycles.
+ */
+void testRamfunc(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RAMFUNC_H_ */
@@ -0,0 +1,439 @@
+#include "request.h"
+#include "frame.h"
+#include "heap.h"
+#include "stream.h"
+#include "trace.h"
+#include "timer.h"
+#include "timebase.h"
+#include <string.h>
+#include <stdio.h>
+
+#define API_KEY "921e078dd8a44054a06172330242501"
+
+// Rendered in front of the body, with the body length substituted for Content-Length
+const char* const requestHeader = "POST /v1/current.json?key=" API_KEY "&q=bulk HTTP/1.1\nHost: api.weatherapi.com\nUser-Agent: Windows NT 10.0; +https://github.com/spectre256/forwarder Forwarder/0.0.1\nAccept: application/json\nContent-Type: application/json\nContent-Length: %d\n\n";
+
+const char* const bodyStart = "{\"locations\":[";
+const char* const bodyLocation = "{\"q\":\"%s\",\"custom_id\":\"%d-%08lx\"}";
+const char* const bodyEnd = "]}";
+
+char locations[MAX_LOCATIONS][LOCATION_LEN] = {"47803"};
+int locationCount = 1;
+
+char savedLocations[MAX_LOCATIONS][LOCATION_LEN];
+int savedCount;
+
+LocationResult results[MAX_LOCATIONS];
+
+char* buffer;
+int buffer_i = 0;
+int nl_cnt = 0;
+bool responseReady = false;
+
+char requestBuffer[REQUEST_SIZE];
+bool requestDirty = true;
+int idOffset[MAX_LOCATIONS];    // Where each custom_id's request ID is in requestBuffer
+
+RequestStats requestStats;
+
+RequestState state = REQUEST_IDLE;
+uint32_t id = 0;        // Incremented for every request sent
+uint32_t sentAt = 0;    // Time the request in flight was sent
+uint32_t nextAt = 0;    // Time of the next request (IDLE) or the deadline (IN_FLIGHT)
+int attempt = 0;        // Consecutive failed attempts, used for backoff
+
+void requestDue(Timer* timer);
+void scheduleAt(uint32_t now, uint32_t at);
+Timer requestTimer = TIMER(requestDue);    // Expires at nextAt
+
+#define ID_DIGITS 8  // Hex digits of the request ID in a custom_id
+#define CUSTOM_ID_KEY "\"custom_id\":\""
+
+// Time comparison that tolerates the millisecond counter wrapping
+#define REACHED(now, time) ((int32_t)((now) - (time)) >= 0)
+
+// Queries are copied into a JSON string as is, so anything that would need escaping is rejected
+bool isValidQuery(const char* query) {
+    size_t len = strlen(query);
+    if (len == 0 || len >= LOCATION_LEN) return false;
+
+    for (; *query != '\0'; query++) {
+        if (*query == '"' || *query == '\\' || *query < ' ') return false;
+    }
+
+    return true;
+}
+
+// Renders the bulk request into requestBuffer
+RequestErr renderRequest(void) {
+    // Measure the body first so the header can carry its length
+    int bodyLen = strlen(bodyStart) + strlen(bodyEnd);
+    int i;
+    for (i = 0; i < locationCount; i++) {
+        bodyLen += snprintf(NULL, 0, bodyLocation, locations[i], i, 0ul) + (i > 0);
+    }
+
+    int len = snprintf(requestBuffer, REQUEST_SIZE, requestHeader, bodyLen);
+    len += snprintf(&requestBuffer[len], REQUEST_SIZE - len, "%s", bodyStart);
+    for (i = 0; i < locationCount && len < REQUEST_SIZE; i++) {
+        if (i > 0) requestBuffer[len++] = ',';
+        len += snprintf(&requestBuffer[len], REQUEST_SIZE - len, bodyLocation, locations[i], i, 0ul);
+        idOffset[i] = len - ID_DIGITS - 2;
+    }
+    if (len < REQUEST_SIZE) {
+        len += snprintf(&requestBuffer[len], REQUEST_SIZE - len, "%s", bodyEnd);
+    }
+
+    if (len >= REQUEST_SIZE) {
+        requestBuffer[0] = '\0';
+        return REQUEST_LEN_ERR;
+    }
+
+    requestDirty = false;
+    return SUCCESS;
+}
+
+// Drops the request in flight once the list changes, as its slots no longer match. Bumping the
+//  ID makes whatever still arrives of its response stale, so nothing of it is streamed or bound
+void abandonRequest(void) {
+    if (state != REQUEST_IN_FLIGHT) return;
+
+    uint32_t now = millis();
+    id++;
+    resetReceive();
+    state = REQUEST_IDLE;
+    attempt = 0;
+    scheduleAt(now, now);
+}
+
+// Copy of the list from before a change, put back if the changed list doesn't render
+void saveLocations(void) {
+    memcpy(savedLocations, locations, sizeof(locations));
+    savedCount = locationCount;
+}
+
+// Renders the changed list, or restores and re-renders the saved one if it doesn't fit
+RequestErr commitLocations(void) {
+    requestDirty = true;
+    RequestErr err = renderRequest();
+    if (err) {
+        memcpy(locations, savedLocations, sizeof(locations));
+        locationCount = savedCount;
+        renderRequest();
+    } else {
+        abandonRequest();
+    }
+    return err;
+}
+
+RequestErr addLocation(const char* query) {
+    if (locationCount >= MAX_LOCATIONS) return LOCATION_FULL_ERR;
+    if (!isValidQuery(query)) return LOCATION_CHAR_ERR;
+
+    saveLocations();
+    strcpy(locations[locationCount++], query);
+    return commitLocations();
+}
+
+RequestErr setLocation(int slot, const char* query) {
+    if (slot < 0 || slot >= locationCount) return LOCATION_INDEX_ERR;
+    if (!isValidQuery(query)) return LOCATION_CHAR_ERR;
+
+    saveLocations();
+    strcpy(locations[slot], query);
+    return commitLocations();
+}
+
+RequestErr removeLocation(int slot) {
+    if (slot < 0 || slot >= locationCount) return LOCATION_INDEX_ERR;
+    if (locationCount == 1) return LOCATION_LAST_ERR;
+
+    saveLocations();
+    locationCount--;
+    for (; slot < locationCount; slot++) {
+        strcpy(locations[slot], locations[slot + 1]);
+    }
+
+    return commitLocations();
+}
+
+const char* getRequest(void) {
+    if (requestDirty) renderRequest();
+    return requestBuffer;
+}
+
+// Writes the request ID into every custom_id of the rendered request
+void stampRequest(uint32_t requestID) {
+    int i;
+    int digit;
+    if (requestBuffer[0] == '\0') return;
+
+    for (i = 0; i < locationCount; i++) {
+        for (digit = 0; digit < ID_DIGITS; digit++) {
+            requestBuffer[idOffset[i] + digit] = "0123456789abcdef"[(requestID >> (4 * (ID_DIGITS - 1 - digit))) & 0xF];
+        }
+    }
+}
+
+int requestSlot(const char* customID, size_t length) {
+    int slot = 0;
+    uint32_t requestID = 0;
+    size_t i;
+
+    // Slot digits up to the dash
+    for (i = 0; i < length && customID[i] >= '0' && customID[i] <= '9'; i++) {
+        slot = slot * 10 + customID[i] - '0';
+    }
+    if (i == 0 || i + 1 + ID_DIGITS != length || customID[i] != '-') return -1;
+
+    // Exactly ID_DIGITS lowercase hex digits of the request ID
+    for (i++; i < length; i++) {
+        char c = customID[i];
+        if (c >= '0' && c <= '9') {
+            requestID = requestID << 4 | (c - '0');
+        } else if (c >= 'a' && c <= 'f') {
+            requestID = requestID << 4 | (c - 'a' + 10);
+        } else {
+            return -1;
+        }
+    }
+
+    return requestID == id && slot < locationCount ? slot : -1;
+}
+
+// Parses the slot index out of a custom_id value, or returns -1
+int parseSlot(JSONValue* customID) {
+    if (!customID || customID->type != STRING) return -1;
+    return requestSlot(customID->value.str->str, customID->value.str->length);
+}
+
+void bindResults(JSONValue* json) {
+    memset(results, 0, sizeof(results));
+
+    JSONValue* bulk = JSONGet(json, "bulk");
+    if (!bulk || bulk->type != ARRAY) return;
+
+    JSONValue* entry;
+    arrayForeach(bulk->value.array, entry, _i) {
+        JSONValue* query = JSONGet(entry, "query");
+        int slot = parseSlot(JSONGet(query, "custom_id"));
+        if (slot < 0) continue;
+
+        results[slot].location = JSONGet(query, "location");
+        results[slot].current = JSONGet(query, "current");
+    }
+}
+
+void initRequest(void) {
+    buffer = heapAlloc(HEAP_REQUEST, BUFFER_SIZE * sizeof(char));
+
+    // Seed the retry jitter per device, as the cycles since reset alone barely vary between boots
+#ifdef __MSP432P4111__
+    srand(TLV->RANDOM_NUM_1 ^ TLV->RANDOM_NUM_2 ^ TLV->RANDOM_NUM_3 ^ TLV->RANDOM_NUM_4 ^ (uint32_t)nowCycles());
+#else
+    srand((uint32_t)nowCycles());
+#endif
+
+    // Send the first request as soon as timers run
+    timerStart(&requestTimer, 0, 0);
+}
+
+void requestReceive(void) {
+    int c;
+    while (!responseReady && (c = frameRead(CHANNEL_HTTP)) >= 0) {
+        char input = c;
+
+        // Set flag if input is a NUL character
+        if (input == '\0') {
+            buffer[buffer_i] = '\0';
+            buffer_i = 0;
+            nl_cnt = 0;
+            responseReady = true;
+            break;
+        }
+
+        // Drop HTTP response headers and only save body
+        if (nl_cnt < 2) {
+            switch (input) {
+            case '\n':
+                nl_cnt++;
+            case '\r':
+                break;
+            default:
+                nl_cnt = 0;
+            }
+        } else if (buffer_i < BUFFER_SIZE - 1) {
+            // Leave room for the NUL so a truncated body still terminates
+            if (buffer_i == 0) streamBegin();
+            buffer[buffer_i] = input;
+            buffer_i++;
+
+            // Publish tracked values as soon as they are complete
+            streamByte(input);
+        }
+    }
+}
+
+void resetReceive(void) {
+    streamAbort();
+    buffer_i = 0;
+    nl_cnt = 0;
+    responseReady = false;
+    frameFlush(CHANNEL_HTTP);
+}
+
+// Sets the time of the next request or the deadline, and the timer to poll then
+void scheduleAt(uint32_t now, uint32_t at) {
+    nextAt = at;
+    timerStart(&requestTimer, REACHED(now, at) ? 0 : at - now, 0);
+}
+
+void requestDue(Timer* timer) {
+    requestPoll(millis());
+}
+
+// Schedules a retry after a timeout or failure
+void scheduleRetry(uint32_t now) {
+    uint32_t backoff = BACKOFF_CAP;
+    if (attempt < 16 && (BACKOFF_BASE << attempt) < BACKOFF_CAP) {
+        backoff = BACKOFF_BASE << attempt;
+    }
+    attempt++;
+
+    // Jitter by up to half the backoff so devices sharing a forwarder don't retry in lockstep
+    backoff += rand() % (backoff / 2 + 1);
+
+    state = REQUEST_IDLE;
+    scheduleAt(now, now + backoff);
+    requestStats.retries++;
+}
+
+void requestPoll(uint32_t now) {
+    // The timer counts a different crystal, so it can run a little early
+    if (!REACHED(now, nextAt)) {
+        scheduleAt(now, nextAt);
+        return;
+    }
+
+    if (state == REQUEST_IN_FLIGHT) {
+        // Deadline passed, so drop whatever was received of the response
+        TRACE(TRACE_REQUEST_TIMEOUT, id, 0);
+        resetReceive();
+        requestStats.timeouts++;
+        scheduleRetry(now);
+        return;
+    }
+
+    // Send the request with its NUL, or try again shortly if the channel is busy
+    const char* request = getRequest();
+    stampRequest(id + 1);
+    resetReceive();
+    if (!frameSend(CHANNEL_HTTP, request, strlen(request) + 1)) {
+        scheduleAt(now, now + SEND_RETRY);
+        return;
+    }
+
+    id++;
+    TRACE(TRACE_REQUEST_SENT, id, 0);
+    requestStats.sent++;
+    state = REQUEST_IN_FLIGHT;
+    sentAt = now;
+    scheduleAt(now, now + REQUEST_TIMEOUT);
+}
+
+bool requestAnswers(const char* body) {
+    const char* customID = strstr(body, CUSTOM_ID_KEY);
+    const char* end = customID ? strchr(customID + strlen(CUSTOM_ID_KEY), '"') : NULL;
+
+    // A body without a custom_id, such as an error, can't be told apart, so it goes to the parser
+    if (state == REQUEST_IN_FLIGHT && (!end
+            || requestSlot(customID + strlen(CUSTOM_ID_KEY), end - customID - strlen(CUSTOM_ID_KEY)) >= 0)) {
+        return true;
+    }
+
+    requestStats.stale++;
+    return false;
+}
+
+bool requestComplete(uint32_t now) {
+    if (state != REQUEST_IN_FLIGHT) return false;
+
+    requestStats.rtt[requestStats.rttCount % RTT_SAMPLES] = now - sentAt;
+    requestStats.rttCount++;
+    requestStats.completed++;
+
+    attempt = 0;
+    state = REQUEST_IDLE;
+    scheduleAt(now, sentAt + POLL_PERIOD);
+    return true;
+}
+
+void requestFailed(uint32_t now) {
+    if (state != REQUEST_IN_FLIGHT) return;
+
+    requestStats.failures++;
+    scheduleRetry(now);
+}
+
+void requestRefresh(void) {
+    if (state == REQUEST_IDLE) {
+        uint32_t now = millis();
+        attempt = 0;
+        scheduleAt(now, now);
+    }
+}
+
+int compareRTT(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+uint32_t requestPercentile(int percentile) {
+    int count = requestStats.rttCount < RTT_SAMPLES ? requestStats.rttCount : RTT_SAMPLES;
+    if (count == 0) return 0;
+
+    // Sort a copy so the ring keeps its order
+    uint32_t sorted[RTT_SAMPLES];
+    memcpy(sorted, requestStats.rtt, count * sizeof(uint32_t));
+    qsort(sorted, count, sizeof(uint32_t), compareRTT);
+
+    int i = (percentile * (count - 1) + 50) / 100;
+    return sorted[i];
+}
+
+inline uint32_t requestID(void) {
+    return id;
+}
+
+inline RequestState requestState(void) {
+    return state;
+}
+
+void testRequest(void) {
+    const char* request = getRequest();
+
+    RequestErr err = addLocation("Terre Haute");
+    err = addLocation("39.47,-87.35");
+    err = addLocation("one too many"); // Should fail with LOCATION_FULL_ERR
+    err = setLocation(1, "bad \"quote\""); // Should fail with LOCATION_CHAR_ERR
+    request = getRequest(); // Check Content-Length against the body here
+
+    JSONValue* json = parseJSON("{\"bulk\":[{\"query\":{\"custom_id\":\"2-00000000\",\"q\":\"39.47,-87.35\",\"current\":{\"temp_f\":44.4}}},{\"query\":{\"custom_id\":\"0-00000000\",\"q\":\"47803\",\"current\":{\"temp_f\":45.1}}}]}");
+    bindResults(json); // Slots 0 and 2 should be bound, slot 1 left NULL
+    destroyJSON(json);
+
+    removeLocation(2);
+    removeLocation(1);
+
+    // Lifecycle: a timeout should back off, a completion should restore the poll period
+    requestPoll(0); // Sends request 1
+    requestPoll(REQUEST_TIMEOUT); // Times out, retry in BACKOFF_BASE plus jitter
+    requestPoll(REQUEST_TIMEOUT + BACKOFF_CAP); // Sends request 2
+    bool late = requestAnswers("{\"bulk\":[{\"query\":{\"custom_id\":\"0-00000001\"}}]}"); // Should be false, answers request 1
+    bool fresh = requestAnswers("{\"bulk\":[{\"query\":{\"custom_id\":\"0-00000002\"}}]}");
+    requestComplete(REQUEST_TIMEOUT + BACKOFF_CAP + 250); // RTT of 250
+    bool stale = requestAnswers("{\"bulk\":[{\"query\":{\"custom_id\":\"0-00000002\"}}]}"); // Should be false, nothing in flight
+    uint32_t median = requestPercentile(50);
+    requestRefresh();
+}
@@ -0,0 +1,193 @@
+/*
+ * request.h
+ *
+ *      Description: Runtime location list and bulk request builder for the
+ *                   weatherapi.com current conditions endpoint. All locations
+ *                   are fetched with a single q=bulk POST, which is rendered
+ *                   once per configuration change rather than on every poll.
+ *
+ *                   Each location's custom_id is "<slot>-<request ID>", with
+ *                   the ID as 8 hex digits stamped in as the request is sent.
+ *                   The API echoes custom_id back, so a late response to an
+ *                   earlier request is told apart from the one in flight.
+ *
+ *      Author: gibbonec
+ */
+
+#ifndef REQUEST_H_
+#define REQUEST_H_
+
+#include "json.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MAX_LOCATIONS 3
+#define LOCATION_LEN 32
+#define REQUEST_SIZE 512
+#define BUFFER_SIZE 960 // Room for a bulk response with three locations
+
+/* Request lifecycle timing, all in milliseconds */
+#define POLL_PERIOD         5000    // Time between successful requests
+#define REQUEST_TIMEOUT     4000    // Time allowed for a full response to arrive
+#define BACKOFF_BASE        500     // First retry delay after a failure
+#define BACKOFF_CAP         30000   // Upper bound on the retry delay before jitter
+#define SEND_RETRY          50      // Time before trying again when the channel is full
+#define RTT_SAMPLES         32      // Number of recent round trips kept for percentiles
+
+// Parsed data for a single location, pointing into the current JSON tree
+typedef struct {
+    JSONValue* location;
+    JSONValue* current;
+} LocationResult;
+
+typedef enum {
+    LOCATION_FULL_ERR = 1,
+    LOCATION_INDEX_ERR,
+    LOCATION_CHAR_ERR,
+    LOCATION_LAST_ERR,
+    REQUEST_LEN_ERR,
+} RequestErr;
+
+typedef enum {
+    REQUEST_IDLE,
+    REQUEST_IN_FLIGHT,
+} RequestState;
+
+// Link health counters, updated by the request lifecycle functions
+typedef struct {
+    uint32_t sent;          // Requests sent, including retries
+    uint32_t completed;     // Responses parsed successfully
+    uint32_t timeouts;      // Requests that passed their deadline
+    uint32_t failures;      // Responses that arrived but failed to parse
+    uint32_t retries;       // Requests sent because of a timeout or failure
+    uint32_t stale;         // Responses to an earlier request, or with none in flight
+    uint32_t rtt[RTT_SAMPLES]; // Ring of recent round trip times
+    int rttCount;           // Total round trips recorded, rtt[rttCount % RTT_SAMPLES] is the oldest
+} RequestStats;
+
+extern RequestStats requestStats;
+
+// Body of the last response, valid while responseReady is set
+extern char* buffer;
+extern int buffer_i;
+extern int nl_cnt;
+extern bool responseReady;
+
+extern char locations[MAX_LOCATIONS][LOCATION_LEN];
+extern int locationCount;
+
+// Result slots, indexed by location. Slots are NULL until a response containing that location is bound
+extern LocationResult results[MAX_LOCATIONS];
+
+/*
+ * Appends a location query (zip code, city name, "lat,lon", ...) to the list
+ *  and re-renders the request. If the request would no longer fit, the list is
+ *  left as it was and REQUEST_LEN_ERR returned, as for setLocation and
+ *  removeLocation.
+ *
+ * A change abandons any request in flight, whose response would bind to the
+ *  slots of the old list, and sends the new list at once.
+ */
+RequestErr addLocation(const char* query);
+
+/*
+ * Replaces the location query in the given slot and re-renders the request.
+ */
+RequestErr setLocation(int slot, const char* query);
+
+/*
+ * Removes the location in the given slot, shifting later locations down, and
+ *  re-renders the request. The last location can't be removed.
+ */
+RequestErr removeLocation(int slot);
+
+/*
+ * Returns the pre-rendered, NUL-terminated HTTP request for all locations.
+ */
+const char* getRequest(void);
+
+/*
+ * Fills the result slots from a parsed bulk response. Each entry of the "bulk"
+ *  array is matched to its slot through the custom_id sent with the request.
+ *  The slots are only valid until the JSON tree is destroyed.
+ */
+void bindResults(JSONValue* json);
+
+/*
+ * Allocates the response buffer, and starts the timer that sends requests.
+ */
+void initRequest(void);
+
+/*
+ * Collects the response from the HTTP channel into buffer, dropping the
+ *  headers, and scans the body as it arrives, see stream.h. Stops at the NUL
+ *  ending the response and sets responseReady, leaving anything after it
+ *  queued.
+ */
+void requestReceive(void);
+
+/*
+ * Discards any partially received response, rolling back values published
+ *  from it, and clears responseReady, so the next byte is treated as the start
+ *  of a new response.
+ */
+void resetReceive(void);
+
+/*
+ * Drives the request lifecycle. Sends a request once the poll period or retry
+ *  delay has elapsed, and if the request in flight passes its deadline, resets
+ *  the receive state and schedules a retry with capped exponential backoff.
+ *  A timer calls it with the current time in milliseconds whenever one is due.
+ */
+void requestPoll(uint32_t now);
+
+/*
+ * Returns the slot a bulk entry's custom_id names, or -1 if it is malformed or
+ *  answers a request other than the last one sent.
+ */
+int requestSlot(const char* customID, size_t length);
+
+/*
+ * Checks a received body against the request in flight by the custom_id of
+ *  its first entry. Returns false, counting it stale, if no request is in
+ *  flight or the body answers an earlier one, meaning it should be ignored.
+ */
+bool requestAnswers(const char* body);
+
+/*
+ * Marks the request in flight as answered, recording its round trip time. Call
+ *  once the response has parsed. Returns false if no request was in flight.
+ */
+bool requestComplete(uint32_t now);
+
+/*
+ * Marks the request in flight as failed (e.g. truncated or invalid response)
+ *  and schedules a retry with backoff.
+ */
+void requestFailed(uint32_t now);
+
+/*
+ * Forces a request now, through the timer.
+ */
+void requestRefresh(void);
+
+/*
+ * Returns the given percentile (0-100) of the recent round trip times in
+ *  milliseconds, or 0 if none have been recorded.
+ */
+uint32_t requestPercentile(int percentile);
+
+uint32_t requestID(void);
+
+RequestState requestState(void);
+
+void testRequest(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* REQUEST_H_ */
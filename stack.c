@@ -0,0 +1,79 @@
+#include "stack.h"
+
+#ifdef __MSP432P4111__
+#include "msp.h"
+
+// Linker symbols, where the size is the symbol's address
+extern uint32_t __STACK_END;
+extern uint32_t __STACK_SIZE;
+
+#define STACK_TOP (&__STACK_END)
+#define STACK_BOTTOM ((uint32_t*)((uint32_t)&__STACK_END - (uint32_t)&__STACK_SIZE))
+#endif
+
+void stackPaint(void) {
+#ifdef __MSP432P4111__
+    // Everything below the stack pointer is free, and this frame is above it
+    uint32_t* word = STACK_BOTTOM;
+    uint32_t* end = (uint32_t*)__get_MSP();
+    while (word < end) {
+        *(word++) = STACK_PAINT;
+    }
+#endif
+}
+
+inline uint32_t stackSize(void) {
+#ifdef __MSP432P4111__
+    return (uint32_t)&__STACK_SIZE;
+#else
+    return 0;
+#endif
+}
+
+uint32_t stackHighWater(void) {
+#ifdef __MSP432P4111__
+    // The stack grows down, so the first word written over is the deepest
+    const uint32_t* word = STACK_BOTTOM;
+    while (word < STACK_TOP && *word == STACK_PAINT) {
+        word++;
+    }
+    return (uint32_t)STACK_TOP - (uint32_t)word;
+#else
+    return 0;
+#endif
+}
+
+inline uint32_t stackUsed(void) {
+#ifdef __MSP432P4111__
+    return (uint32_t)STACK_TOP - __get_MSP();
+#else
+    return 0;
+#endif
+}
+
+inline bool stackOverflowed(void) {
+#ifdef __MSP432P4111__
+    return *STACK_BOTTOM != STACK_PAINT;
+#else
+    return false;
+#endif
+}
+
+// Uses a known amount of stack below the caller
+void stackTouch(void) {
+    volatile uint32_t block[64];
+    int i;
+    for (i = 0; i < 64; i++) {
+        block[i] = i;
+    }
+}
+
+void testStack(void) {
+    uint32_t used = stackUsed();
+    stackTouch();
+
+    // The mark should be at least 256 bytes below here, and the bottom still painted
+    uint32_t highWater = stackHighWater();
+    bool deepEnough = highWater >= used + sizeof(uint32_t[64]);
+    bool overflowed = stackOverflowed();                         // Should be false
+}
@@ -0,0 +1,61 @@
+/*
+ * stack.h
+ *
+ *      Description: Main stack watermark. Reset paints the stack with a known
+ *                   word before the C runtime starts, so the deepest the stack
+ *                   has ever reached is where the paint stops. That is a
+ *                   lower bound, seen only for paths that actually ran, and
+ *                   tools/stackreport.py gives the static worst case.
+ *
+ *                   Interrupts run on the same main stack, so the mark
+ *                   includes them.
+ *
+ *      Author: gibbonec
+ */
+
+#ifndef STACK_H_
+#define STACK_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define STACK_PAINT 0x5AC3A53Cu
+
+/*
+ * Paints the unused stack. Called from Reset_Handler before _c_int00, it must
+ *  not depend on anything the C runtime initializes.
+ */
+void stackPaint(void);
+
+/*
+ * Returns the size of the stack in bytes, as set with --stack_size.
+ */
+uint32_t stackSize(void);
+
+/*
+ * Returns the most stack in bytes used since reset.
+ */
+uint32_t stackHighWater(void);
+
+/*
+ * Returns the stack in bytes in use by the caller.
+ */
+uint32_t stackUsed(void);
+
+/*
+ * Returns true if the paint at the bottom of the stack is gone, so the stack
+ *  has probably overflowed into whatever lies below it.
+ */
+bool stackOverflowed(void);
+
+void testStack(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STACK_H_ */
@@ -46,6 +46,9 @@ extern void _c_int00(void);
 /* External declaration for system initialization function                  */
 extern void SystemInit(void);
 
+/* External declaration for the stack watermark, see stack.h                */
+extern void stackPaint(void);
+
 /* Forward declaration of the default fault handlers. */
 void Default_Handler            (void) __attribute__((weak));
 extern void Reset_Handler       (void) __attribute__((weak));
@@ -184,6 +187,9 @@ void Reset_Handler(void)
 {
     SystemInit();
 
+    /* Paint the free stack so the deepest use can be measured later */
+    stackPaint();
+
     /* Jump to the CCS C Initialization Routine. */
     __asm("    .global _c_int00\n"
           "    b.w     _c_int00");
@@ -0,0 +1,207 @@
+#include "stream.h"
+#include "request.h"
+#include <string.h>
+
+// Paths of the values that matter in a bulk response, with "[]" for an array element
+#define ENTRY_PATH "bulk.[]"
+#define ID_PATH "bulk.[].query.custom_id"
+#define CURRENT_PATH "bulk.[].query.current."
+
+#define PATH_SIZE (STREAM_DEPTH * STREAM_KEY_SIZE)
+
+// Open object or array, and for an object the key of the value being scanned
+typedef struct {
+    bool array;
+    char key[STREAM_KEY_SIZE];
+} Container;
+
+Container streamStack[STREAM_DEPTH];
+int streamDepth = 0;
+int streamOverflow = 0;     // Containers opened past STREAM_DEPTH
+
+bool streamKey = false;     // Next string in an object is a key
+bool streamInString = false;
+bool streamInScalar = false; // Number, true, false or null
+bool streamEscaped = false;
+
+char streamToken[STREAM_TOKEN_SIZE];
+int streamLength = 0;
+
+int streamSlot = 0;         // Slot whose values are published
+int streamEntry = -1;       // custom_id of the bulk entry being scanned, or -1
+
+// Joins the keys leading to the value being scanned
+void buildPath(char* path) {
+    int i;
+    path[0] = '\0';
+    for (i = 0; i < streamDepth; i++) {
+        if (i > 0) strcat(path, ".");
+        strcat(path, streamStack[i].array ? "[]" : streamStack[i].key);
+    }
+}
+
+void appendToken(char c) {
+    // Longer values are cut off, as a Reading would cut them off
+    if (streamLength < STREAM_TOKEN_SIZE - 1) streamToken[streamLength++] = c;
+}
+
+// Handles a complete string or scalar value
+void finishValue(bool string) {
+    char path[PATH_SIZE];
+    streamToken[streamLength] = '\0';
+    if (streamOverflow) return;
+    buildPath(path);
+
+    if (strcmp(path, ID_PATH) == 0) {
+        // Entries answering an earlier request are never published
+        streamEntry = string ? requestSlot(streamToken, streamLength) : -1;
+        return;
+    }
+
+    size_t prefix = strlen(CURRENT_PATH);
+    if (streamEntry != streamSlot || strncmp(path, CURRENT_PATH, prefix) != 0) return;
+
+    if (string) {
+        // Strings are kept as received, escapes and all, like the parser does
+        JSONString str = {streamToken, streamLength};
+        JSONValue value = {STRING};
+        value.value.str = &str;
+        publishValue(streamSlot, &path[prefix], &value);
+    } else {
+        JSONValue* value = parseJSONValue(streamToken);
+        if (value && value->type != JSONERR) publishValue(streamSlot, &path[prefix], value);
+        destroyJSON(value);
+    }
+}
+
+// Opens an object or array as the value being scanned
+void openContainer(bool array) {
+    char path[PATH_SIZE];
+    if (streamDepth >= STREAM_DEPTH || streamOverflow) {
+        streamOverflow++;
+        return;
+    }
+
+    // A new bulk entry has no custom_id until its own arrives
+    buildPath(path);
+    if (strcmp(path, ENTRY_PATH) == 0) streamEntry = -1;
+
+    streamStack[streamDepth].array = array;
+    streamStack[streamDepth].key[0] = '\0';
+    streamDepth++;
+    streamKey = !array;
+}
+
+void closeContainer(void) {
+    if (streamOverflow) {
+        streamOverflow--;
+    } else if (streamDepth > 0) {
+        streamDepth--;
+    }
+    streamKey = false;
+}
+
+inline void streamTarget(int slot) {
+    streamSlot = slot;
+}
+
+void streamBegin(void) {
+    streamDepth = 0;
+    streamOverflow = 0;
+    streamKey = false;
+    streamInString = false;
+    streamInScalar = false;
+    streamEscaped = false;
+    streamLength = 0;
+    streamEntry = -1;
+}
+
+void streamByte(char c) {
+    if (streamInString) {
+        if (streamEscaped) {
+            streamEscaped = false;
+        } else if (c == '\\') {
+            streamEscaped = true;
+        } else if (c == '"') {
+            streamInString = false;
+            if (streamKey) {
+                // Keys too long to be tracked can't match any path
+                Container* container = &streamStack[streamDepth - 1];
+                bool fits = streamLength < STREAM_KEY_SIZE;
+                streamToken[streamLength] = '\0';
+                strcpy(container->key, fits ? streamToken : "~");
+                streamKey = false;
+            } else {
+                finishValue(true);
+            }
+            return;
+        }
+        appendToken(c);
+        return;
+    }
+
+    if (streamInScalar) {
+        if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || c == '-' || c == '+' || c == '.' || c == 'E') {
+            appendToken(c);
+            return;
+        }
+        streamInScalar = false;
+        finishValue(false);
+    }
+
+    switch (c) {
+    case '{':
+        openContainer(false);
+        break;
+    case '[':
+        openContainer(true);
+        break;
+    case '}':
+    case ']':
+        closeContainer();
+        break;
+    case ',':
+        streamKey = streamDepth > 0 && !streamOverflow && !streamStack[streamDepth - 1].array;
+        break;
+    case '"':
+        // Keys only matter where the containers are tracked
+        streamInString = true;
+        streamKey = streamKey && streamDepth > 0 && !streamOverflow;
+        streamLength = 0;
+        break;
+    case ':':
+    case ' ':
+    case '\t':
+    case '\r':
+    case '\n':
+        break;
+    default:
+        streamInScalar = true;
+        streamLength = 0;
+        appendToken(c);
+    }
+}
+
+void streamAbort(void) {
+    streamBegin();
+    rollback();
+}
+
+void testStream(void) {
+    const char* body = "{\"bulk\":[{\"query\":{\"custom_id\":\"1-00000000\",\"current\":{\"temp_f\":10.0}}},"
+            "{\"query\":{\"custom_id\":\"0-00000000\",\"current\":{\"temp_f\":71.5,\"condition\":{\"text\":\"Sunny\",\"code\":1000}}}}]}";
+
+    // Only the entry for slot 0 is published
+    streamTarget(0);
+    streamBegin();
+    for (; *body != '\0'; body++) {
+        streamByte(*body);
+    }
+
+    float temp = currentReading(TOPIC_TEMP)->number;                // Should be 71.5
+    const char* text = currentReading(TOPIC_CONDITION)->text;       // Should be "Sunny"
+
+    // The body never arrived in full, so undo it
+    streamAbort();
+    temp = currentReading(TOPIC_TEMP)->number;                      // Should be back to before
+}
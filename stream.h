@@ -0,0 +1,59 @@
+/*
+ * stream.h
+ *
+ *      Description: Incremental scanner over a response body as it arrives.
+ *                   Tracks the key path of every value, without building a
+ *                   tree, and publishes the values under "current" of one
+ *                   bulk entry through publishValue as soon as each is
+ *                   complete, so the LCD can show them before the rest of
+ *                   the body has been received.
+ *
+ *                   The entry is chosen by its custom_id, which the forwarder
+ *                   sends ahead of "current". Values are provisional until
+ *                   the whole body parses; streamAbort rolls them back.
+ *
+ *      Author: gibbonec
+ */
+
+#ifndef STREAM_H_
+#define STREAM_H_
+
+#include "notify.h"
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define STREAM_DEPTH 8          // Deepest nesting tracked
+#define STREAM_KEY_SIZE 16      // Longest key tracked, including the NUL
+#define STREAM_TOKEN_SIZE READING_TEXT_SIZE  // Longest value kept, including the NUL
+
+/*
+ * Sets the location slot whose values are published from the next response.
+ */
+void streamTarget(int slot);
+
+/*
+ * Starts scanning a new response body.
+ */
+void streamBegin(void);
+
+/*
+ * Scans the next byte of the body.
+ */
+void streamByte(char c);
+
+/*
+ * Stops scanning a response that was cut short or failed, rolling back any
+ *  values published from it.
+ */
+void streamAbort(void);
+
+void testStream(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STREAM_H_ */
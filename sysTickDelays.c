@@ -2,50 +2,46 @@
  * sysTickDelays.c
  *      Description: Helper file for delay functions using SysTick timer. Must be
  *                   initialized with system clock frequency using initDelayTimer.
+ *                   Delays are deadlines on the free-running counter of
+ *                   timebase.h, so SysTick is never reprogrammed, and
+ *                   follow MCLK as the clock policy switches it.
  *
  *      Author: ece230
  */
 
 #include <msp.h>
+#include <stdint.h>
 #include "sysTickDelays.h"
+#include "timebase.h"
+#include "clock.h"
 
 #define USEC_DIVISOR    1000000
 #define MSEC_DIVISOR    1000
-#define SYSTICK_LIMIT   0x00FFFFFF
-
-/* Holds frequency of system clock, must be set in initDelayTimer */
-uint64_t sysClkFreq = 0;
 
 void initDelayTimer(uint32_t clkFreq) {
-    // store value of system clock (MCLK) frequency
-    //   used for tick count calculations
-    sysClkFreq = clkFreq;
+    // start the shared counter unless it's already running
+    if (!(SysTick->CTRL & SysTick_CTRL_ENABLE_Msk)) {
+        initTimebase(clkFreq);
+    }
 }
 
 int delayMicroSec(uint32_t micros) {
-    // calculate timer ticks needed for \b micros microseconds
-    uint64_t ticks = sysClkFreq * micros / USEC_DIVISOR;
-    // if requested delay is too short or exceeds max period of SysTick timer,
-    //  return error state
+    // calculate timer ticks needed for \b micros microseconds, at the MCLK the clock policy set
+    uint64_t ticks = (uint64_t)clockMCLK() * micros / USEC_DIVISOR;
+    // if requested delay is too short to measure, return error state
     if (ticks < 2) {
         return UNDERFLOW;
-    } else if (ticks > SYSTICK_LIMIT) {
-        return OVERFLOW;
     }
 
-    // Set the period of the SysTick counter
-    SysTick->LOAD = ticks - 1;
-    // Write any value to reset timer counter
-    SysTick->VAL = 1;
-    // Enable SysTick timer
-    SysTick->CTRL |= SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_ENABLE_Msk;
-    // Wait for SysTick COUNT flag
-    while (!(SysTick->CTRL & SysTick_CTRL_COUNTFLAG_Msk));
-    // Disable SysTick timer
-    SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+    // Wait for the free-running counter to pass the deadline
+    waitUntil(deadlineAfter(micros));
     return SUCCESS;
 }
 
 int delayMilliSec(uint32_t millis) {
+    // 1000 * millis would overflow for delays over 71 minutes
+    if (millis > UINT32_MAX / 1000) {
+        return OVERFLOW;
+    }
     return delayMicroSec(1000 * millis);
 }
@@ -44,8 +44,7 @@ extern void initDelayTimer(uint32_t clkFreq);
  *
  * \param micros is the number of microseconds to delay
  *
- * \return 0 on success, 1 if microsecond count is too large,
- *              2 if microsecond count is too small
+ * \return 0 on success, 2 if microsecond count is too small
  */
 extern int delayMicroSec(uint32_t micros);
 
@@ -0,0 +1,127 @@
+#include "msp.h"
+#include "task.h"
+#include "timebase.h"
+
+#define NO_TASK NUM_TASKS
+
+#define TASK_CONFIG(task, name, run, priority, deadline, events) \
+    { name, run, priority, deadline, events },
+
+const TaskConfig taskConfigs[NUM_TASKS] = {
+    TASKS(TASK_CONFIG)
+};
+
+TaskStats taskStats[NUM_TASKS];
+
+volatile uint32_t taskReady = 0;
+uint64_t taskReadyAt[NUM_TASKS];    // Cycle count each ready task became ready at
+
+#define TASK_LOCK()     uint32_t primask = __get_PRIMASK(); __disable_irq()
+#define TASK_UNLOCK()   __set_PRIMASK(primask)
+
+// Marks a task ready, with the lock held
+void readyTask(Task task, uint64_t now) {
+    if (!(taskReady & (1u << task))) {
+        taskReady |= 1u << task;
+        taskReadyAt[task] = now;
+    }
+    taskStats[task].posts++;
+}
+
+void taskPost(Task task) {
+    TASK_LOCK();
+    readyTask(task, nowCycles());
+    TASK_UNLOCK();
+
+    eventPost(EVENT_WORK);
+}
+
+// Makes ready every task waiting on one of the events
+void readyEvents(EventSet events) {
+    int i;
+
+    if (!events) return;
+
+    uint64_t now = nowCycles();
+    TASK_LOCK();
+    for (i = 0; i < NUM_TASKS; i++) {
+        if (taskConfigs[i].events & events) readyTask((Task)i, now);
+    }
+    TASK_UNLOCK();
+}
+
+// Takes the ready task of highest priority, returning NO_TASK if there is none
+Task takeTask(uint64_t* readyAt) {
+    Task next = NO_TASK;
+    int i;
+
+    TASK_LOCK();
+    for (i = 0; i < NUM_TASKS; i++) {
+        if ((taskReady & (1u << i))
+                && (next == NO_TASK || taskConfigs[i].priority < taskConfigs[next].priority)) {
+            next = (Task)i;
+        }
+    }
+    if (next != NO_TASK) {
+        taskReady &= ~(1u << next);
+        *readyAt = taskReadyAt[next];
+    }
+    TASK_UNLOCK();
+
+    return next;
+}
+
+void runTask(Task task, uint64_t readyAt) {
+    TaskStats* stats = &taskStats[task];
+    uint32_t perMicro = cyclesPerMicrosecond();
+
+    uint64_t start = nowCycles();
+    taskConfigs[task].run();
+    uint64_t end = nowCycles();
+
+    uint32_t latency = (start - readyAt) / perMicro;
+    uint32_t run = (end - start) / perMicro;
+    stats->runs++;
+    stats->totalRun += run;
+    if (latency > stats->maxLatency) stats->maxLatency = latency;
+    if (run > stats->maxRun) stats->maxRun = run;
+    if (end - readyAt > (uint64_t)taskConfigs[task].deadline * 1000 * perMicro) stats->misses++;
+}
+
+void taskSchedule(void) {
+    Task task;
+    uint64_t readyAt;
+
+    while (true) {
+        readyEvents(eventWait());
+
+        while ((task = takeTask(&readyAt)) != NO_TASK) {
+            runTask(task, readyAt);
+
+            // Let whatever was posted meanwhile compete with the tasks already ready
+            readyEvents(eventPoll());
+        }
+    }
+}
+
+inline const char* taskName(Task task) {
+    return taskConfigs[task].name;
+}
+
+void testTasks(void) {
+    uint64_t readyAt;
+
+    // The parse, posted first, should come out after the button
+    taskPost(TASK_PARSE);
+    readyEvents(EVENT_BIT(EVENT_BUTTON));
+    taskPost(TASK_PARSE);
+    Task first = takeTask(&readyAt);            // Should be TASK_BUTTON
+    Task second = takeTask(&readyAt);           // Should be TASK_PARSE
+    Task none = takeTask(&readyAt);             // Should be NO_TASK
+
+    // Both posts of the parse count, though it was only ready once
+    uint32_t posts = taskStats[TASK_PARSE].posts;
+
+    // Drop the wakeups the posts left behind
+    eventPoll();
+}
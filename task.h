@@ -0,0 +1,95 @@
+/*
+ * task.h
+ *
+ *      Description: Cooperative run-to-completion scheduler. Each task is a
+ *                   function that does some work and returns:
+ *
+ *                   X(task, name, run, priority, deadline, events)
+ *
+ *                   run       void function, defined by the module that owns the work
+ *                   priority  0 runs first, equal priorities run in table order
+ *                   deadline  ms from becoming ready to finishing
+ *                   events    mask of the events, see event.h, that make it ready
+ *
+ *                   A task is ready once until it runs, however often it is
+ *                   posted. After every task the scheduler takes the events
+ *                   posted meanwhile, so whatever they make ready competes
+ *                   with the rest by priority. A long parse still runs to
+ *                   the end, but a button press is served next rather than
+ *                   after everything else queued.
+ *
+ *                   A task that leaves work behind posts itself again. It
+ *                   should only do so while it makes progress, or tasks of
+ *                   lower priority never run.
+ *
+ *      Author: gibbonec
+ */
+
+#ifndef TASK_H_
+#define TASK_H_
+
+#include "event.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TASKS(X) \
+    X(TASK_BUTTON, "button", buttonTask,   0, 50,  EVENT_BIT(EVENT_BUTTON)) \
+    X(TASK_TIMER,  "timer",  timerProcess, 0, 20,  EVENT_BIT(EVENT_TIMER)) \
+    X(TASK_LINK,   "link",   linkTask,     1, 10,  EVENT_BIT(EVENT_UART)) \
+    X(TASK_RENDER, "render", renderTask,   2, 50,  EVENT_BIT(EVENT_MARQUEE)) \
+    X(TASK_PARSE,  "parse",  parseTask,    3, 250, 0)
+
+#define TASK_ENUM(task, name, run, priority, deadline, events) task,
+#define TASK_DECLARE(task, name, run, priority, deadline, events) void run(void);
+
+typedef enum {
+    TASKS(TASK_ENUM)
+    NUM_TASKS,
+} Task;
+
+TASKS(TASK_DECLARE)
+
+typedef struct {
+    const char* name;
+    void (*run)(void);
+    uint8_t priority;
+    uint16_t deadline;      // ms
+    EventSet events;
+} TaskConfig;
+
+typedef struct {
+    uint32_t posts;
+    uint32_t runs;
+    uint32_t misses;        // Runs that finished past the deadline
+    uint32_t maxLatency;    // Most microseconds from ready to running
+    uint32_t maxRun;        // Most microseconds of a run
+    uint64_t totalRun;
+} TaskStats;
+
+extern const TaskConfig taskConfigs[NUM_TASKS];
+extern TaskStats taskStats[NUM_TASKS];
+
+/*
+ * Makes a task ready and wakes the scheduler. Safe from any context.
+ */
+void taskPost(Task task);
+
+/*
+ * Runs the ready tasks in order of priority, and sleeps while there are none.
+ *  Never returns.
+ */
+void taskSchedule(void);
+
+const char* taskName(Task task);
+
+void testTasks(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TASK_H_ */
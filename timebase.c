@@ -0,0 +1,83 @@
+#include "msp.h"
+#include "timebase.h"
+
+#define SYSTICK_BITS 24
+
+volatile uint32_t sysTickWraps = 0;
+uint32_t cyclesPerMicro = 1;
+
+// Reference cycles per SysTick tick, and the counts at the last clock change
+uint32_t cyclesPerTick = 1;
+uint64_t cyclesBefore = 0;
+uint64_t ticksBefore = 0;
+
+void initTimebase(uint32_t clkFreq) {
+    cyclesPerMicro = clkFreq / 1000000;
+
+    // Count MCLK down through the whole range, interrupting on every wrap
+    SysTick->LOAD = SYSTICK_LIMIT;
+    SysTick->VAL = 0;
+    SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk | SysTick_CTRL_ENABLE_Msk;
+}
+
+// Returns the SysTick ticks since initTimebase, at whatever rate MCLK ran
+uint64_t nowTicks(void) {
+    uint32_t high;
+    uint32_t low;
+    bool pending;
+
+    // Read until the wrap count is stable around the counter
+    do {
+        high = sysTickWraps;
+        low = SysTick->VAL;
+        pending = SCB->ICSR & SCB_ICSR_PENDSTSET_Msk;
+    } while (high != sysTickWraps);
+
+    // A wrap whose interrupt hasn't run yet, because interrupts are masked or
+    //  this is a higher priority handler, reloaded the counter near the top
+    if (pending && low > SYSTICK_LIMIT / 2) high++;
+
+    return ((uint64_t)high << SYSTICK_BITS) + (SYSTICK_LIMIT - low);
+}
+
+uint64_t nowCycles(void) {
+    return cyclesBefore + (nowTicks() - ticksBefore) * cyclesPerTick;
+}
+
+void timebaseClock(uint32_t clkFreq) {
+    uint64_t ticks = nowTicks();
+
+    // Carry the count over at the old rate, then count on at the new one
+    cyclesBefore += (ticks - ticksBefore) * cyclesPerTick;
+    ticksBefore = ticks;
+    cyclesPerTick = cyclesPerMicro * 1000000 / clkFreq;
+}
+
+inline uint64_t nowMicros(void) {
+    return nowCycles() / cyclesPerMicro;
+}
+
+inline uint32_t millis(void) {
+    return nowMicros() / 1000;
+}
+
+inline uint32_t cyclesPerMicrosecond(void) {
+    return cyclesPerMicro;
+}
+
+inline uint64_t deadlineAfter(uint32_t micros) {
+    return nowCycles() + (uint64_t)micros * cyclesPerMicro;
+}
+
+inline bool deadlinePassed(uint64_t deadline) {
+    return nowCycles() >= deadline;
+}
+
+void waitUntil(uint64_t deadline) {
+    while (!deadlinePassed(deadline));
+}
+
+// SysTick interrupt extending the counter on every wrap
+void SysTick_Handler(void) {
+    sysTickWraps++;
+}
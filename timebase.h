@@ -0,0 +1,80 @@
+/*
+ * timebase.h
+ *
+ *      Description: Free-running monotonic timebase. SysTick counts MCLK
+ *                   down through its full 24 bit range without ever being
+ *                   reprogrammed, and its wrap interrupt extends it to a 64
+ *                   bit cycle count, so anything can timestamp events and
+ *                   waits are deadlines against the same counter rather than
+ *                   reloads of the timer.
+ *
+ *                   SysTick wraps every 2^24 cycles, about 350 ms at 48 MHz.
+ *                   The count stays correct with interrupts masked for up to
+ *                   one wrap.
+ *
+ *                   Cycles are always at the frequency given to
+ *                   initTimebase. When MCLK is divided down, timebaseClock
+ *                   scales each SysTick tick to make up the difference, so
+ *                   times and deadlines don't change meaning.
+ *
+ *      Author: gibbonec
+ */
+
+#ifndef TIMEBASE_H_
+#define TIMEBASE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SYSTICK_LIMIT 0x00FFFFFF
+
+/*
+ * Starts the counter. The clock frequency in Hz must be a whole number of MHz.
+ */
+void initTimebase(uint32_t clkFreq);
+
+/*
+ * Tells the timebase MCLK now runs at clkFreq, which must divide the frequency
+ *  given to initTimebase. Call with interrupts masked, right after the change.
+ */
+void timebaseClock(uint32_t clkFreq);
+
+/*
+ * Returns the cycles since initTimebase, at the frequency it was given.
+ */
+uint64_t nowCycles(void);
+
+/*
+ * Returns the microseconds since initTimebase.
+ */
+uint64_t nowMicros(void);
+
+/*
+ * Returns the milliseconds since initTimebase, wrapping every 49.7 days.
+ */
+uint32_t millis(void);
+
+uint32_t cyclesPerMicrosecond(void);
+
+/*
+ * Returns the cycle count the given number of microseconds from now, for use
+ *  with deadlinePassed and waitUntil.
+ */
+uint64_t deadlineAfter(uint32_t micros);
+
+bool deadlinePassed(uint64_t deadline);
+
+/*
+ * Spins until the cycle count reaches the deadline.
+ */
+void waitUntil(uint64_t deadline);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIMEBASE_H_ */
@@ -0,0 +1,260 @@
+#include "msp.h"
+#include "timer.h"
+#include "event.h"
+
+#define SLOT_MASK       (TIMER_SLOTS - 1)
+#define LEVEL_SHIFT(level) ((level) * TIMER_SLOT_BITS)
+#define WHEEL_REACH     (1ul << LEVEL_SHIFT(TIMER_LEVELS))
+#define MAX_SLEEP       0x4000  // Ticks, well within the 16 bit counter so timerNow never misses a wrap
+
+TimerStats timerStats;
+
+Timer* wheel[TIMER_LEVELS][TIMER_SLOTS];
+uint32_t occupied[TIMER_LEVELS];    // Bit per slot holding a timer
+uint32_t wheelNow = 0;      // Next tick to process
+bool wheelBusy = false;     // timerProcess is running callbacks, and arms the compare after them
+
+uint32_t timerRate = 1;     // Ticks per second
+uint32_t counterTicks = 0;  // TIMER_A0 extended to 32 bits
+uint16_t counterLast = 0;
+
+uint32_t testExpiries = 0;
+
+// Index of the lowest set bit, which must exist
+int lowestBit(uint32_t bits) {
+    return __CLZ(__RBIT(bits));
+}
+
+// Rotates slot bits right, so bit k is the slot k after the given one
+uint32_t fromSlot(uint32_t bits, uint32_t slot) {
+    return slot ? (bits >> slot) | (bits << (TIMER_SLOTS - slot)) : bits;
+}
+
+uint32_t msToTicks(uint32_t ms) {
+    return ((uint64_t)ms * timerRate + 999) / 1000;
+}
+
+// TIMER_A0 counts ACLK, asynchronous to MCLK, so read until two reads agree
+uint16_t readCounter(void) {
+    uint16_t count;
+    do {
+        count = TIMER_A0->R;
+    } while (count != TIMER_A0->R);
+    return count;
+}
+
+uint32_t timerNow(void) {
+    uint16_t count = readCounter();
+    counterTicks += (uint16_t)(count - counterLast);
+    counterLast = count;
+    return counterTicks;
+}
+
+void initTimers(uint32_t aclkFreq) {
+    timerRate = aclkFreq;
+    counterTicks = 0;
+    counterLast = 0;
+    wheelNow = 0;
+
+    // Count continuously, with the compare moved to each next expiry
+    TIMER_A0->CCR[0] = MAX_SLEEP;
+    TIMER_A0->CCTL[0] = TIMER_A_CCTLN_CCIE;
+    TIMER_A0->CTL = TIMER_A_CTL_SSEL__ACLK | TIMER_A_CTL_MC__CONTINUOUS | TIMER_A_CTL_CLR;
+
+    NVIC->ISER[0] = 1 << TA0_0_IRQn;
+}
+
+// Puts a timer in the slot of the lowest level reaching its expiry
+void placeTimer(Timer* timer) {
+    uint32_t expires = timer->expires;
+    uint32_t delta = expires - wheelNow;
+    int level;
+
+    if ((int32_t)delta < 0) {
+        // Already due, so run it with the tick being processed
+        expires = wheelNow;
+        delta = 0;
+    } else if (delta >= WHEEL_REACH) {
+        // Wait in the last slot, and be placed again from there
+        expires = wheelNow + WHEEL_REACH - 1;
+        delta = WHEEL_REACH - 1;
+    }
+
+    for (level = 0; level < TIMER_LEVELS - 1 && delta >= 1ul << LEVEL_SHIFT(level + 1); level++);
+    uint32_t slot = (expires >> LEVEL_SHIFT(level)) & SLOT_MASK;
+
+    timer->level = level;
+    timer->slot = slot;
+    timer->prev = NULL;
+    timer->next = wheel[level][slot];
+    if (timer->next) timer->next->prev = timer;
+    wheel[level][slot] = timer;
+    occupied[level] |= 1u << slot;
+
+    timer->active = true;
+    timerStats.active++;
+}
+
+void unlinkTimer(Timer* timer) {
+    if (timer->prev) {
+        timer->prev->next = timer->next;
+    } else {
+        wheel[timer->level][timer->slot] = timer->next;
+        if (!timer->next) occupied[timer->level] &= ~(1u << timer->slot);
+    }
+    if (timer->next) timer->next->prev = timer->prev;
+
+    timer->active = false;
+    timerStats.active--;
+}
+
+// Moves the timers of the level's slot for the current tick down the wheel, returning the slot
+uint32_t cascade(int level) {
+    uint32_t slot = (wheelNow >> LEVEL_SHIFT(level)) & SLOT_MASK;
+    Timer* timer;
+
+    while ((timer = wheel[level][slot]) != NULL) {
+        unlinkTimer(timer);
+        placeTimer(timer);
+        timerStats.cascades++;
+    }
+    return slot;
+}
+
+// Runs the timers of a level 0 slot, including any started due meanwhile
+void expireSlot(uint32_t slot, uint32_t now) {
+    Timer* timer;
+
+    while ((timer = wheel[0][slot]) != NULL) {
+        unlinkTimer(timer);
+        timerStats.expired++;
+        if (now - timer->expires > timerStats.maxLate) timerStats.maxLate = now - timer->expires;
+
+        // Periodic timers skip the periods they missed rather than running in a burst
+        if (timer->period) {
+            timer->expires += timer->period;
+            if ((int32_t)(timer->expires - now) <= 0) timer->expires = now + timer->period;
+            placeTimer(timer);
+        }
+        timer->callback(timer);
+    }
+    wheelNow++;
+}
+
+void advanceWheel(uint32_t now) {
+    int level;
+
+    while ((int32_t)(now - wheelNow) >= 0) {
+        uint32_t slot = wheelNow & SLOT_MASK;
+
+        // Bring the next slot of each level down as the level below wraps around to it
+        if (slot == 0) {
+            for (level = 1; level < TIMER_LEVELS && cascade(level) == 0; level++);
+        }
+
+        // Skip to the next slot holding a timer, or to the wrap
+        uint32_t ahead = occupied[0] >> slot;
+        if (!ahead) {
+            uint32_t wrap = (wheelNow | SLOT_MASK) + 1;
+            wheelNow = (int32_t)(wrap - now) <= 0 ? wrap : now + 1;
+            continue;
+        }
+        uint32_t skip = lowestBit(ahead);
+        if ((int32_t)(now - (wheelNow + skip)) < 0) {
+            wheelNow = now + 1;
+            break;
+        }
+        wheelNow += skip;
+        expireSlot(slot + skip, now);
+    }
+}
+
+// Sets the compare for the next tick with a timer to run or a cascade to do
+void armTimer(void) {
+    uint32_t next = wheelNow + MAX_SLEEP;
+    uint32_t bits;
+    int level;
+
+    bits = fromSlot(occupied[0], wheelNow & SLOT_MASK);
+    if (bits) next = wheelNow + lowestBit(bits);
+
+    for (level = 1; level < TIMER_LEVELS; level++) {
+        uint32_t span = 1ul << LEVEL_SHIFT(level);
+        uint32_t first = (wheelNow + span - 1) & ~(span - 1);  // Next cascade of this level
+        bits = fromSlot(occupied[level], (first >> LEVEL_SHIFT(level)) & SLOT_MASK);
+        if (!bits) continue;
+
+        uint32_t at = first + lowestBit(bits) * span;
+        if ((int32_t)(at - next) < 0) next = at;
+    }
+
+    TIMER_A0->CCR[0] = (uint16_t)next;
+
+    // The compare only matches as the count reaches it, so catch a tick already passed
+    if ((int32_t)(next - timerNow()) <= 0) eventPost(EVENT_TIMER);
+}
+
+void timerStart(Timer* timer, uint32_t delay, uint32_t period) {
+    if (timer->active) unlinkTimer(timer);
+
+    timer->expires = timerNow() + msToTicks(delay);
+    timer->period = msToTicks(period);
+    placeTimer(timer);
+    timerStats.starts++;
+
+    if (!wheelBusy) armTimer();
+}
+
+void timerStop(Timer* timer) {
+    if (!timer->active) return;
+    unlinkTimer(timer);
+    timerStats.stops++;
+}
+
+inline bool timerActive(const Timer* timer) {
+    return timer->active;
+}
+
+void timerProcess(void) {
+    wheelBusy = true;
+    advanceWheel(timerNow());
+    wheelBusy = false;
+    armTimer();
+}
+
+// Compare interrupt, leaving the work to the timer task
+void TA0_0_IRQHandler(void) {
+    // Clear compare interrupt flag
+    TIMER_A0->CCTL[0] &= ~TIMER_A_CCTLN_CCIFG;
+    timerStats.wakes++;
+    eventPost(EVENT_TIMER);
+}
+
+void testExpired(Timer* timer) {
+    testExpiries++;
+}
+
+void testTimers(void) {
+    Timer once = TIMER(testExpired);
+    Timer periodic = TIMER(testExpired);
+    Timer far = TIMER(testExpired);
+
+    // A stopped timer never runs, and a far one sits high in the wheel
+    timerStart(&far, 600000, 0);
+    uint8_t farLevel = far.level;                   // Should be 3
+    timerStop(&far);
+
+    // One expiry at 10 ms, and four of the periodic by 200 ms
+    testExpiries = 0;
+    uint32_t wakes = timerStats.wakes;
+    timerStart(&once, 10, 0);
+    timerStart(&periodic, 50, 50);
+    while (testExpiries < 5) {
+        if (eventWait() & EVENT_BIT(EVENT_TIMER)) timerProcess();
+    }
+    timerStop(&periodic);
+
+    // Tickless, so a handful of wakes rather than one for each of the 50 ticks
+    wakes = timerStats.wakes - wakes;
+    uint32_t late = timerStats.maxLate;
+}
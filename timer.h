@@ -0,0 +1,107 @@
+/*
+ * timer.h
+ *
+ *      Description: Software timers on a hierarchical timer wheel, all
+ *                   driven by TIMER_A0 counting ACLK. Each of the
+ *                   TIMER_LEVELS levels has TIMER_SLOTS slots, and a slot
+ *                   of level n spans TIMER_SLOTS^n ticks. A timer goes in
+ *                   the slot of the lowest level that reaches its expiry,
+ *                   and moves down a level each time the level below wraps
+ *                   around to it, so starting and stopping one is O(1).
+ *                   Timers further out than the wheel reaches wait in its
+ *                   last slot and are placed again when they get there.
+ *
+ *                   The hardware timer is one-shot and tickless. It counts
+ *                   freely and compares at the next slot holding a timer
+ *                   or a cascade, so the CPU sleeps until then rather than
+ *                   waking every tick.
+ *
+ *                   The interrupt only posts EVENT_TIMER. Callbacks run
+ *                   from timerProcess in the timer task, so they may start
+ *                   and stop timers, post tasks, or do short work. Start
+ *                   and stop timers from tasks, never from interrupts.
+ *
+ *                   A tick is 1 / ACLK, about 4 ms at 256 Hz. The LCD keeps
+ *                   TIMER_A1, as its phases are microseconds long.
+ *
+ *      Author: gibbonec
+ */
+
+#ifndef TIMER_H_
+#define TIMER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TIMER_SLOT_BITS 5
+#define TIMER_SLOTS     (1 << TIMER_SLOT_BITS)
+#define TIMER_LEVELS    4       // Reaches 2^20 ticks, over an hour at 256 Hz
+
+typedef struct Timer Timer;
+
+typedef void (*TimerCallback)(Timer* timer);
+
+struct Timer {
+    Timer* next;
+    Timer* prev;
+    uint32_t expires;       // Tick
+    uint32_t period;        // Ticks, 0 for one-shot
+    TimerCallback callback;
+    uint8_t level;
+    uint8_t slot;
+    bool active;
+};
+
+// Initializer for a stopped timer
+#define TIMER(callback) { NULL, NULL, 0, 0, callback, 0, 0, false }
+
+typedef struct {
+    uint32_t starts;
+    uint32_t stops;
+    uint32_t expired;
+    uint32_t cascades;      // Timers moved down a level
+    uint32_t wakes;         // Compare interrupts
+    uint32_t maxLate;       // Most ticks a callback ran after its expiry
+    uint16_t active;
+} TimerStats;
+
+extern TimerStats timerStats;
+
+/*
+ * Starts TIMER_A0 counting ACLK at the given frequency in Hz.
+ */
+void initTimers(uint32_t aclkFreq);
+
+/*
+ * Starts, or restarts, a timer to expire after delay ms and then every period
+ *  ms, or only once if period is 0.
+ */
+void timerStart(Timer* timer, uint32_t delay, uint32_t period);
+
+void timerStop(Timer* timer);
+
+bool timerActive(const Timer* timer);
+
+/*
+ * Returns the ticks since initTimers.
+ */
+uint32_t timerNow(void);
+
+/*
+ * Runs the callbacks of every timer that has expired and sets the compare for
+ *  the next. The timer task.
+ */
+void timerProcess(void);
+
+void testTimers(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIMER_H_ */
@@ -0,0 +1,283 @@
+#!/usr/bin/env python3
+"""
+Static worst case stack report for the firmware.
+
+Every source file is compiled with GCC's -fcallgraph-info=su, which writes each
+function's frame size and its calls. The report lists, for every function, its
+own frame and the deepest stack any call from it can reach. It then adds up the
+main stack: main, plus the deepest interrupt handler and the exception frame it
+pushes. All handlers run at the same priority, so they never nest.
+
+Frames come from GCC for the Cortex-M4, not from the TI compiler that builds the
+firmware, so they are an estimate. Pass --margin to allow for the difference.
+
+Recursion (the parser, the trie and destroyJSON) is unrolled --depth times.
+Calls through function pointers follow the INDIRECT table, and the field
+formatters come from layout.h. Library functions
+have no frame information. They count as 0 unless given with --extern, and
+each root lists the ones it reaches.
+
+The exit status is 1 if any --limit is exceeded, or if the main stack does not
+fit --stack_size from msp432p4111.cmd. Run it as a post-build step to fail the
+build, e.g.
+    tools/stackreport.py -I $CCS/ccs_base/arm/include -I $CCS/ccs_base/arm/include/CMSIS \\
+        --limit parseJSON=1024
+"""
+
+import argparse
+import glob
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+TARGET_FLAGS = ["-mcpu=cortex-m4", "-mthumb", "-mfloat-abi=hard", "-mfpu=fpv4-sp-d16",
+                "-D__MSP432P4111__", "-Dccs", "-std=gnu99", "-fgnu89-inline", "-O0", "-w"]
+
+# TI's startup and clock code, which only run before main
+SKIP = ["startup_msp432p4111_ccs.c", "system_msp432p4111.c"]
+
+# Targets of the calls made through function pointers, besides the formatters in layout.h
+INDIRECT = {
+    "destroyArray": ["destroyJSONVoid"],
+    "destroyMap": ["destroyJSONVoid"],
+    "mapInsert": ["destroyJSONVoid"],
+    "arrayDelete": ["destroyJSONVoid"],
+    "notifyTopic": ["readingChanged"],
+    "switchClock": ["uartClock", "lcdClock"],
+    "runTask": ["buttonTask", "timerProcess", "linkTask", "renderTask", "parseTask"],
+    "expireSlot": ["requestDue", "holdExpired", "marqueeTick", "buttonSettled", "testExpired"],
+}
+
+# Hardware stacked registers with the FPU context, plus alignment padding
+EXCEPTION_FRAME = 26 * 4 + 4
+
+ROOT = re.compile(r"^(main|\w+_Handler|\w+_IRQHandler)$")
+NODE = re.compile(r'node: \{ title: "([^"]+)" label: "[^"\\]*(?:\\n[^"\\]*)*?(?:\\n(\d+) bytes \(([\w,]+)\))?"')
+EDGE = re.compile(r'edge: \{ sourcename: "([^"]+)" targetname: "([^"]+)"')
+
+
+def compile_graphs(cc, flags, sources, out):
+    """Compiles every source into out, where GCC leaves a .ci per file."""
+    for source in sources:
+        obj = os.path.join(out, os.path.splitext(os.path.basename(source))[0] + ".o")
+        cmd = [cc] + flags + ["-fcallgraph-info=su", "-c", source, "-o", obj]
+        result = subprocess.run(cmd, stderr=subprocess.PIPE, universal_newlines=True)
+        if result.returncode != 0:
+            sys.exit("%s failed:\n%s" % (" ".join(cmd), result.stderr))
+    return glob.glob(os.path.join(out, "*.ci"))
+
+
+def layout_formatters(path):
+    """Reads the formatter and detail formatter columns of LAYOUT."""
+    rows = re.findall(r"^\s*X\((.*)\)", open(path).read(), re.MULTILINE)
+    columns = [[column.strip() for column in row.split(",")] for row in rows]
+    return sorted({row[i] for row in columns if len(row) == 10 for i in (3, 8) if row[i] != "NULL"})
+
+
+def short(name):
+    """Static functions are titled with their file's path, keep only the file."""
+    return re.sub(r"^.*/", "", name)
+
+
+def load_graphs(paths, indirect):
+    """Returns the frame of every defined function, its callees, and dynamic frames."""
+    frames = {}
+    calls = {}
+    dynamic = set()
+    for path in paths:
+        text = open(path).read()
+        for name, size, kind in NODE.findall(text):
+            if size:
+                frames[short(name)] = int(size)
+                if kind == "dynamic":
+                    dynamic.add(short(name))
+        for source, target in EDGE.findall(text):
+            calls.setdefault(short(source), set()).add(short(target))
+
+    # Resolve function pointers
+    for caller, targets in calls.items():
+        if "__indirect_call" in targets:
+            targets.discard("__indirect_call")
+            targets.update(indirect.get(caller, ["__indirect_call"]))
+    return frames, calls, dynamic
+
+
+def components(calls, nodes):
+    """Tarjan's strongly connected components, to tell which functions recurse."""
+    index = {}
+    low = {}
+    stack = []
+    on_stack = set()
+    component = {}
+    counter = [0]
+
+    def visit(node):
+        index[node] = low[node] = counter[0]
+        counter[0] += 1
+        stack.append(node)
+        on_stack.add(node)
+        for callee in calls.get(node, ()):
+            if callee not in index:
+                visit(callee)
+                low[node] = min(low[node], low[callee])
+            elif callee in on_stack:
+                low[node] = min(low[node], index[callee])
+        if low[node] == index[node]:
+            members = []
+            while True:
+                member = stack.pop()
+                on_stack.discard(member)
+                members.append(member)
+                if member == node:
+                    break
+            for member in members:
+                component[member] = frozenset(members)
+
+    sys.setrecursionlimit(10000)
+    for node in nodes:
+        if node not in index:
+            visit(node)
+    return component
+
+
+class Analysis:
+    def __init__(self, frames, calls, externs, depth):
+        self.frames = frames
+        self.calls = calls
+        self.externs = externs
+        self.depth = depth
+        nodes = set(frames) | set(calls) | {c for cs in calls.values() for c in cs}
+        self.component = components(calls, nodes)
+        self.memo = {}
+
+    def frame(self, name):
+        return self.frames.get(name, self.externs.get(name, 0))
+
+    def recursive(self, name):
+        return len(self.component[name]) > 1 or name in self.calls.get(name, ())
+
+    def worst(self, name, counts=()):
+        """Returns (bytes, path) of the deepest chain of calls from name.
+
+        counts holds how often each function of name's own recursive cycle is
+        already on the path. Nothing outside the cycle can lead back into it, so
+        that is all the result depends on.
+        """
+        key = (name, counts)
+        if key in self.memo:
+            return self.memo[key]
+
+        seen = dict(counts)
+        seen[name] = seen.get(name, 0) + 1
+        best = (0, [])
+        for callee in sorted(self.calls.get(name, ())):
+            inner = ()
+            if self.component[callee] == self.component[name]:
+                if seen.get(callee, 0) >= self.depth:
+                    continue
+                inner = tuple(sorted(seen.items()))
+            result = self.worst(callee, inner)
+            if result[0] > best[0] or not best[1]:
+                best = result
+
+        result = (self.frame(name) + best[0], [name] + best[1])
+        self.memo[key] = result
+        return result
+
+    def reached(self, name, seen=None):
+        """Returns every function reachable from name."""
+        seen = set() if seen is None else seen
+        if name not in seen:
+            seen.add(name)
+            for callee in self.calls.get(name, ()):
+                self.reached(callee, seen)
+        return seen
+
+
+def stack_budget(path):
+    match = re.search(r"^--stack_size=(\d+)", open(path).read(), re.MULTILINE)
+    return int(match.group(1)) if match else None
+
+
+def main():
+    repo = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--cc", default="arm-none-eabi-gcc", help="GCC to compile with (default: %(default)s)")
+    parser.add_argument("--cflags", help="flags replacing the Cortex-M4 defaults, e.g. for a host GCC")
+    parser.add_argument("-I", dest="include", action="append", default=[], help="include directory for msp.h and CMSIS")
+    parser.add_argument("--ci", nargs="+", help="use these .ci files rather than compiling")
+    parser.add_argument("--depth", type=int, default=8, help="times a recursive cycle is unrolled (default: %(default)s)")
+    parser.add_argument("--extern", action="append", default=[], metavar="NAME=BYTES",
+                        help="stack of a library function")
+    parser.add_argument("--limit", action="append", default=[], metavar="NAME=BYTES",
+                        help="fail if the worst case from this function is over BYTES")
+    parser.add_argument("--margin", type=int, default=0, help="bytes added to the main stack total")
+    parser.add_argument("--all", action="store_true", help="list every function, not only the roots and limits")
+    args = parser.parse_args()
+
+    externs = {name: int(size) for name, size in (e.split("=") for e in args.extern)}
+    limits = [(name, int(size)) for name, size in (l.split("=") for l in args.limit)]
+
+    with tempfile.TemporaryDirectory() as out:
+        if args.ci:
+            paths = args.ci
+        else:
+            flags = (args.cflags.split() if args.cflags else TARGET_FLAGS) + ["-I" + d for d in args.include + [repo]]
+            sources = [s for s in sorted(glob.glob(os.path.join(repo, "*.c"))) if os.path.basename(s) not in SKIP]
+            paths = compile_graphs(args.cc, flags, sources, out)
+        indirect = dict(INDIRECT, renderField=layout_formatters(os.path.join(repo, "layout.h")))
+        frames, calls, dynamic = load_graphs(paths, indirect)
+
+    analysis = Analysis(frames, calls, externs, args.depth)
+    roots = sorted(name for name in frames if ROOT.match(name))
+    failed = False
+
+    print("%-28s %6s %6s  %s" % ("function", "frame", "worst", "deepest path"))
+    listed = sorted(frames, key=lambda name: -analysis.worst(name)[0]) if args.all else roots + [n for n, _ in limits]
+    for name in listed:
+        total, path = analysis.worst(name)
+        flag = " (recursive)" if analysis.recursive(name) else ""
+        flag += " (dynamic)" if name in dynamic else ""
+        print("%-28s %6d %6d  %s%s" % (name, analysis.frame(name), total, " > ".join(path[1:]) or "-", flag))
+
+    for name in roots:
+        unknown = sorted(f for f in analysis.reached(name)
+                         if f not in frames and f not in externs and f != "__indirect_call")
+        if unknown:
+            print("%s reaches library functions without frames: %s" % (name, " ".join(unknown)))
+        if "__indirect_call" in analysis.reached(name):
+            print("%s makes calls through unresolved function pointers, add them to INDIRECT" % name)
+
+    for name, size in limits:
+        if name not in frames:
+            print("limit: %s not found" % name)
+            failed = True
+            continue
+        total = analysis.worst(name)[0]
+        if total > size:
+            print("limit: %s needs %d bytes, over its limit of %d" % (name, total, size))
+            failed = True
+
+    handlers = [name for name in roots if name != "main"]
+    deepest = max(handlers, key=lambda name: analysis.worst(name)[0]) if handlers else None
+    total = analysis.worst("main")[0] if "main" in frames else 0
+    if deepest:
+        total += analysis.worst(deepest)[0] + EXCEPTION_FRAME
+    total += args.margin
+
+    budget = stack_budget(os.path.join(repo, "msp432p4111.cmd"))
+    print("main stack: main %d + %s %d + exception frame %d + margin %d = %d of %s" % (
+        analysis.worst("main")[0] if "main" in frames else 0, deepest or "no handler",
+        analysis.worst(deepest)[0] if deepest else 0, EXCEPTION_FRAME if deepest else 0,
+        args.margin, total, budget if budget else "unknown"))
+    if budget and total > budget:
+        print("main stack is over --stack_size")
+        failed = True
+
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,264 @@
+#!/usr/bin/env python3
+"""
+Host stand-in for the forwarder, used to exercise the UART link at full line rate.
+
+Speaks the framed protocol of frame.h. Every NUL-terminated request on the HTTP
+channel is answered with a canned HTTP response followed by a NUL, paced at the
+line rate and honoring XON/XOFF from the device. Like the API, the response
+echoes the custom_id the request gave each location slot. A "BAUD <rate>"
+command on the control channel is answered with "BAUD OK" and the link switches
+to that rate.
+Telemetry from the device is printed as it arrives.
+
+With --flood, responses are streamed back to back without waiting for requests,
+echoing the custom_ids of the last request seen.
+With --stats N, a STATS command is sent after every N responses, and with
+--profile and --trace a PROFILE and a TRACE command along with it. Trace dumps
+are decoded with tracedecode.py.
+
+With --pty, a pseudo-terminal is created and its name printed, so the link can be
+bridged to the LaunchPad (or anything else) with e.g.
+    socat /dev/ttyACM0,b38400,raw,echo=0 <pty>
+Otherwise the given serial device is opened directly.
+"""
+
+import argparse
+import os
+import re
+import select
+import sys
+import termios
+import time
+import tty
+
+XON = 0x11
+XOFF = 0x13
+
+FRAME_MAX_PAYLOAD = 64
+FRAME_END = 0xC0
+FRAME_ESC = 0xDB
+ESCAPES = {FRAME_END: 0xDC, FRAME_ESC: 0xDD, XON: 0xDE, XOFF: 0xDF}
+UNESCAPES = {v: k for k, v in ESCAPES.items()}
+
+CHANNEL_HTTP = 0
+CHANNEL_CONTROL = 1
+CHANNEL_TELEMETRY = 2
+
+DEFAULT_BODY = (
+    b'{"bulk":[{"query":{"custom_id":"0-00000000","q":"47803",'
+    b'"location":{"name":"Terre Haute","region":"Indiana","country":"USA"},'
+    b'"current":{"temp_f":44.4,"condition":{"text":"Partly cloudy","code":1003},'
+    b'"wind_mph":23.0,"wind_dir":"S","humidity":58}}}]}'
+)
+
+BAUD_CONSTANTS = {
+    9600: termios.B9600, 19200: termios.B19200, 38400: termios.B38400,
+    57600: termios.B57600, 115200: termios.B115200, 230400: termios.B230400,
+    460800: termios.B460800, 921600: termios.B921600,
+}
+
+
+CUSTOM_ID = re.compile(rb'"custom_id":"(\d+)-([0-9a-f]*)"')
+
+
+def echo_ids(request, body):
+    """Replaces each custom_id in the body with the one the request gave the same slot."""
+    ids = {m.group(1): m.group(0) for m in CUSTOM_ID.finditer(request)}
+    return CUSTOM_ID.sub(lambda m: ids.get(m.group(1), m.group(0)), body)
+
+
+def crc16(data, crc=0xFFFF):
+    """CRC-16/CCITT-FALSE, as in frame.c."""
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021 if crc & 0x8000 else crc << 1) & 0xFFFF
+    return crc
+
+
+def encode(channel, payload):
+    """Splits a payload into SLIP encoded frames."""
+    out = bytearray()
+    for i in range(0, len(payload), FRAME_MAX_PAYLOAD):
+        chunk = payload[i:i + FRAME_MAX_PAYLOAD]
+        frame = bytes([channel, len(chunk)]) + chunk
+        crc = crc16(frame)
+        frame += bytes([crc >> 8, crc & 0xFF])
+
+        out.append(FRAME_END)
+        for b in frame:
+            if b in ESCAPES:
+                out += bytes([FRAME_ESC, ESCAPES[b]])
+            else:
+                out.append(b)
+        out.append(FRAME_END)
+    return bytes(out)
+
+
+def set_speed(fd, baud):
+    attrs = termios.tcgetattr(fd)
+    attrs[4] = attrs[5] = BAUD_CONSTANTS[baud]
+    termios.tcsetattr(fd, termios.TCSADRAIN, attrs)
+
+
+def open_link(args):
+    if args.pty:
+        master, slave = os.openpty()
+        tty.setraw(slave)
+        print("pty:", os.ttyname(slave), flush=True)
+        return master
+
+    fd = os.open(args.device, os.O_RDWR | os.O_NOCTTY)
+    tty.setraw(fd)
+    set_speed(fd, args.baud)
+    return fd
+
+
+class Link:
+    def __init__(self, fd, baud):
+        self.fd = fd
+        self.byte_time = 10.0 / baud  # 8N1
+        self.paused = False
+        self.pauses = 0
+        self.paused_time = 0.0
+        self.sent = 0
+        self.bad_frames = 0
+        self.frame = bytearray()
+        self.escaped = False
+        self.partial = {CHANNEL_HTTP: bytearray(), CHANNEL_CONTROL: bytearray(), CHANNEL_TELEMETRY: bytearray()}
+        self.pending = {channel: [] for channel in self.partial}
+
+    def finish_frame(self):
+        frame, self.frame = bytes(self.frame), bytearray()
+        if len(frame) < 4 or len(frame) != frame[1] + 4 or frame[0] not in self.partial \
+                or crc16(frame[:-2]) != (frame[-2] << 8 | frame[-1]):
+            self.bad_frames += 1
+            return
+
+        # Payloads are byte streams; split each channel into NUL-terminated messages
+        channel = frame[0]
+        for b in frame[2:-2]:
+            if b == 0:
+                self.pending[channel].append(bytes(self.partial[channel]))
+                self.partial[channel].clear()
+            else:
+                self.partial[channel].append(b)
+
+    def poll(self, timeout):
+        """Reads whatever the device sent, handling flow control bytes."""
+        ready, _, _ = select.select([self.fd], [], [], timeout)
+        if not ready:
+            return
+        for b in os.read(self.fd, 4096):
+            if b == XOFF:
+                if not self.paused:
+                    self.pauses += 1
+                self.paused = True
+            elif b == XON:
+                self.paused = False
+            elif b == FRAME_END:
+                if self.frame:
+                    self.finish_frame()
+                self.escaped = False
+            elif self.escaped:
+                self.frame.append(UNESCAPES.get(b, b))
+                self.escaped = False
+            elif b == FRAME_ESC:
+                self.escaped = True
+            else:
+                self.frame.append(b)
+
+        for report in self.pending[CHANNEL_TELEMETRY]:
+            print("telemetry:", report.decode(errors="replace"), file=sys.stderr)
+        self.pending[CHANNEL_TELEMETRY].clear()
+
+    def send(self, channel, payload):
+        """Sends a payload one byte per byte time, holding off while paused."""
+        next_at = time.monotonic()
+        for b in encode(channel, payload):
+            if self.paused:
+                start = time.monotonic()
+                while self.paused:
+                    self.poll(0.01)
+                self.paused_time += time.monotonic() - start
+                next_at = time.monotonic()
+            else:
+                self.poll(0)
+
+            now = time.monotonic()
+            if next_at > now:
+                time.sleep(next_at - now)
+            os.write(self.fd, bytes([b]))
+            next_at += self.byte_time
+            self.sent += 1
+
+    def control(self, args):
+        """Answers commands from the device on the control channel."""
+        while self.pending[CHANNEL_CONTROL]:
+            command = self.pending[CHANNEL_CONTROL].pop(0)
+            if not command.startswith(b"BAUD "):
+                print("control:", command.decode(errors="replace"), file=sys.stderr)
+                continue
+
+            baud = int(command[5:])
+            if baud not in BAUD_CONSTANTS:
+                self.send(CHANNEL_CONTROL, b"ERR baud\0")
+                continue
+            self.send(CHANNEL_CONTROL, b"BAUD OK\0")
+            if not args.pty:
+                set_speed(self.fd, baud)
+            self.byte_time = 10.0 / baud
+            print("switched to %d baud" % baud, file=sys.stderr)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--device", default="/dev/ttyACM0")
+    parser.add_argument("--pty", action="store_true", help="create a pty instead of opening --device")
+    parser.add_argument("--baud", type=int, default=38400, choices=sorted(BAUD_CONSTANTS))
+    parser.add_argument("--body", help="file holding the response body (default: one bulk location)")
+    parser.add_argument("--flood", action="store_true", help="stream responses without waiting for requests")
+    parser.add_argument("--count", type=int, default=0, help="stop after this many responses (0: forever)")
+    parser.add_argument("--stats", type=int, default=0, help="send STATS after this many responses (0: never)")
+    parser.add_argument("--profile", action="store_true", help="send PROFILE along with STATS")
+    parser.add_argument("--trace", action="store_true", help="send TRACE along with STATS")
+    args = parser.parse_args()
+
+    body = open(args.body, "rb").read() if args.body else DEFAULT_BODY
+    request = b""
+
+    link = Link(open_link(args), args.baud)
+    start = time.monotonic()
+    responses = 0
+    try:
+        while args.count == 0 or responses < args.count:
+            link.control(args)
+            if not args.flood:
+                if not link.pending[CHANNEL_HTTP]:
+                    link.poll(0.1)
+                    continue
+            if link.pending[CHANNEL_HTTP]:
+                request = link.pending[CHANNEL_HTTP].pop(0)
+
+            answer = echo_ids(request, body)
+            link.send(CHANNEL_HTTP, (b"HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+                                     b"Content-Length: %d\r\n\r\n" % len(answer)) + answer + b"\0")
+            responses += 1
+            if args.stats and responses % args.stats == 0:
+                link.send(CHANNEL_CONTROL, b"STATS\0")
+                if args.profile:
+                    link.send(CHANNEL_CONTROL, b"PROFILE\0")
+                if args.trace:
+                    link.send(CHANNEL_CONTROL, b"TRACE\0")
+    except KeyboardInterrupt:
+        pass
+
+    elapsed = time.monotonic() - start
+    print("responses: %d, bytes: %d, %.0f B/s (line rate %.0f B/s)" % (
+        responses, link.sent, link.sent / elapsed if elapsed else 0, 1 / link.byte_time), file=sys.stderr)
+    print("pauses: %d, paused for %.3f s, bad frames: %d" % (link.pauses, link.paused_time, link.bad_frames),
+          file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
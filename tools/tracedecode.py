@@ -0,0 +1,146 @@
+#!/usr/bin/env python3
+"""
+Decodes trace dumps from the device into a readable timeline.
+
+A dump is the telemetry the TRACE control command produces, as printed by
+standin.py, e.g.
+    tools/standin.py --pty --stats 10 --trace 2> log
+    tools/tracedecode.py log
+
+Format strings come from traceEvents.h, so the device never sends them. Records
+are 16 bytes of little endian hex: cycle count, event, context (the exception
+number active when the record was written, 0 in the main loop), sequence and
+two arguments.
+
+Cycle counts are MCLK cycles, so their rate follows the clock policy. Each clock
+record switches the rate from there on, and the rate before the first one is
+the rate it switched from, or MCLK when the dump began.
+
+With --chrome, the last dump is also written as Chrome trace JSON, for
+chrome://tracing or https://ui.perfetto.dev.
+"""
+
+import argparse
+import json
+import os
+import re
+import struct
+import sys
+
+RECORD = struct.Struct("<IBBHII")
+
+# Exception numbers of the handlers that write records, IRQ n being exception 16 + n
+CONTEXTS = {0: "main", 15: "SysTick", 16 + 10: "TA1_0", 16 + 8: "TA0_0", 16 + 16: "EUSCIA0"}
+
+
+def load_events(path):
+    """Reads the X(event, format) rows of TRACE_EVENTS, in order."""
+    text = open(path).read()
+    rows = re.findall(r'X\(\s*(\w+)\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)', text)
+    # %u has no Python equivalent, the rest of the conversions carry over
+    return [(name, re.sub(r"%(\d*)u", r"%\1d", fmt)) for name, fmt in rows]
+
+
+def read_dumps(lines):
+    """Yields (freq, records, lost) for every complete dump in the log, freq being MCLK at the start."""
+    freq = None
+    records = []
+    for line in lines:
+        start = line.find("trace ")
+        if start < 0:
+            continue
+        words = line[start:].split()
+        if words[1] == "begin":
+            fields = dict(word.split("=") for word in words[2:])
+            freq = int(fields.get("mclk", fields["freq"]))
+            records = []
+        elif words[1] == "end" and freq is not None:
+            yield freq, records, int(words[2].split("=")[1])
+            freq = None
+        elif freq is not None:
+            data = bytes.fromhex(words[1])
+            records += [RECORD.unpack_from(data, i) for i in range(0, len(data), RECORD.size)]
+
+
+def message(events, event, a, b):
+    if event >= len(events):
+        return "unknown event %d a=%d b=%d" % (event, a, b)
+    fmt = events[event][1]
+    args = (a, b)[:fmt.count("%") - 2 * fmt.count("%%")]
+    try:
+        return fmt % args
+    except (TypeError, ValueError):
+        return "%s a=%d b=%d" % (fmt, a, b)
+
+
+def timeline(freq, records, clock):
+    """Unwraps the 32 bit cycle counts into microseconds from the first record.
+
+    clock is the index of the clock event, whose arguments are the new and old
+    MCLK in MHz.
+    """
+    switches = [b for time, event, context, sequence, a, b in records if event == clock]
+    rate = switches[0] * 1e6 if switches else freq
+    out = []
+    elapsed = 0.0
+    previous = None
+    for time, event, context, sequence, a, b in records:
+        if previous is not None:
+            # Records are in claim order, so an interrupted writer can stamp slightly later than the next record
+            delta = (time - previous) & 0xFFFFFFFF
+            elapsed += (delta - (1 << 32) if delta >= 1 << 31 else delta) * 1e6 / rate
+        previous = time
+        if event == clock:
+            rate = a * 1e6
+        out.append((elapsed, event, context, sequence, a, b))
+    return out
+
+
+def context_name(context):
+    return CONTEXTS.get(context, "irq %d" % (context - 16) if context >= 16 else "exception %d" % context)
+
+
+def chrome(events, decoded):
+    trace = []
+    for context in sorted(set(record[2] for record in decoded)):
+        trace.append({"name": "thread_name", "ph": "M", "pid": 1, "tid": context,
+                      "args": {"name": context_name(context)}})
+    for us, event, context, sequence, a, b in decoded:
+        name = events[event][0] if event < len(events) else "unknown"
+        trace.append({"name": name, "ph": "i", "s": "t", "ts": us, "pid": 1, "tid": context,
+                      "args": {"message": message(events, event, a, b), "a": a, "b": b}})
+    return {"traceEvents": trace, "displayTimeUnit": "ns"}
+
+
+def main():
+    default_events = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "traceEvents.h")
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("log", nargs="?", help="telemetry log holding trace dumps (default: stdin)")
+    parser.add_argument("--events", default=default_events, help="traceEvents.h the firmware was built with")
+    parser.add_argument("--chrome", help="write the last dump as Chrome trace JSON to this file")
+    args = parser.parse_args()
+
+    events = load_events(args.events)
+    clock = [name for name, fmt in events].index("TRACE_CLOCK")
+    lines = open(args.log) if args.log else sys.stdin
+
+    decoded = None
+    for freq, records, lost in read_dumps(lines):
+        decoded = timeline(freq, records, clock)
+        print("dump: %d records at %d Hz, %d lost" % (len(records), freq, lost))
+        last = 0.0
+        for us, event, context, sequence, a, b in decoded:
+            print("%12.3f ms %+10.1f us  %-8s %s" % (us / 1000, us - last, context_name(context),
+                                                    message(events, event, a, b)))
+            last = us
+
+    if decoded is None:
+        sys.exit("no complete trace dump found")
+
+    if args.chrome:
+        with open(args.chrome, "w") as out:
+            json.dump(chrome(events, decoded), out)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,106 @@
+#include "trace.h"
+#include "frame.h"
+#include "timebase.h"
+#include "clock.h"
+#include <stdio.h>
+#include <string.h>
+
+#define TRACE_PER_LINE 4    // Records per telemetry line, as 32 hex digits each
+
+TraceRecord traceRing[TRACE_RING_SIZE];
+volatile uint32_t traceHead = 0;
+
+// Dump in progress, from dumpNext up to dumpEnd
+bool dumping = false;
+bool dumpStarted = false;
+uint32_t dumpNext;
+uint32_t dumpEnd;
+uint32_t dumpLost;
+
+// Sends a NUL-terminated line on the telemetry channel if there's room
+bool sendLine(const char* line) {
+    return frameSend(CHANNEL_TELEMETRY, line, strlen(line) + 1);
+}
+
+// Appends a value as little endian hex
+char* appendHex(char* out, uint32_t value, int bytes) {
+    const char* digits = "0123456789abcdef";
+    while (bytes--) {
+        *(out++) = digits[(value >> 4) & 0xF];
+        *(out++) = digits[value & 0xF];
+        value >>= 8;
+    }
+    return out;
+}
+
+void traceDump(void) {
+    // Records claimed after this are left for the next dump
+    dumpEnd = traceHead;
+    dumpNext = dumpEnd > TRACE_RING_SIZE ? dumpEnd - TRACE_RING_SIZE : 0;
+    dumpLost = 0;
+    dumping = true;
+    dumpStarted = false;
+}
+
+inline bool traceDumping(void) {
+    return dumping;
+}
+
+void traceProcess(void) {
+    char line[8 + TRACE_PER_LINE * 2 * sizeof(TraceRecord)];
+
+    if (!dumping) return;
+
+    if (!dumpStarted) {
+        snprintf(line, sizeof(line), "trace begin freq=%lu mclk=%lu records=%lu",
+                (unsigned long)cyclesPerMicrosecond() * 1000000, (unsigned long)clockMCLK(),
+                (unsigned long)(dumpEnd - dumpNext));
+        if (!sendLine(line)) return;
+        dumpStarted = true;
+    }
+
+    while (dumpNext != dumpEnd) {
+        strcpy(line, "trace ");
+        char* out = &line[strlen(line)];
+
+        // Skip records overwritten since the dump started, as their sequence moved on
+        int i;
+        uint32_t lost = 0;
+        uint32_t index = dumpNext;
+        for (i = 0; i < TRACE_PER_LINE && index != dumpEnd; index++) {
+            const TraceRecord* record = &traceRing[index & TRACE_MASK];
+            if (record->sequence != (uint16_t)index) {
+                lost++;
+                continue;
+            }
+            out = appendHex(out, record->time, 4);
+            out = appendHex(out, record->event, 1);
+            out = appendHex(out, record->context, 1);
+            out = appendHex(out, record->sequence, 2);
+            out = appendHex(out, record->a, 4);
+            out = appendHex(out, record->b, 4);
+            i++;
+        }
+        *out = '\0';
+
+        if (i > 0 && !sendLine(line)) return;
+        dumpNext = index;
+        dumpLost += lost;
+    }
+
+    snprintf(line, sizeof(line), "trace end lost=%lu", (unsigned long)dumpLost);
+    if (sendLine(line)) dumping = false;
+}
+
+void testTrace(void) {
+    uint32_t head = traceHead;
+
+    TRACE(TRACE_MARQUEE, 0, 0);
+    TRACE(TRACE_UART_RX, 'A', 1);
+
+    // Should be the two records above, with consecutive sequences
+    const TraceRecord* first = &traceRing[head & TRACE_MASK];
+    const TraceRecord* second = &traceRing[(head + 1) & TRACE_MASK];
+    uint32_t cycles = second->time - first->time;
+    char c = second->a;     // Should be 'A'
+}
@@ -0,0 +1,107 @@
+/*
+ * trace.h
+ *
+ *      Description: Binary event trace. TRACE writes a fixed size record of
+ *                   cycle timestamp, event, context and two arguments into a
+ *                   RAM ring, from an ISR or the main loop, with no locks and
+ *                   no formatting. Slots are claimed with LDREX/STREX, which
+ *                   fail if an interrupt came in between, so nested writers
+ *                   never share a slot. The newest TRACE_RING_SIZE records
+ *                   are kept.
+ *
+ *                   The TRACE control command dumps the ring as hex on the
+ *                   telemetry channel, a line at a time as the queue drains,
+ *                   for tools/tracedecode.py to turn into a timeline or a
+ *                   Chrome trace.
+ *
+ *      Author: gibbonec
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include "traceEvents.h"
+#include "profile.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TRACE_RING_SIZE 512     // Records kept, must be a power of 2
+#define TRACE_MASK (TRACE_RING_SIZE - 1)
+
+#define TRACE_ENUM(event, format) event,
+
+typedef enum {
+    TRACE_EVENTS(TRACE_ENUM)
+    NUM_TRACE_EVENTS,
+} TraceEvent;
+
+// 16 bytes, little endian, as dumped
+typedef struct {
+    uint32_t time;      // DWT cycle count
+    uint8_t event;      // TraceEvent
+    uint8_t context;    // Active exception number, 0 in the main loop
+    uint16_t sequence;  // Low bits of the record's index, to spot slots overwritten during a dump
+    uint32_t a;
+    uint32_t b;
+} TraceRecord;
+
+extern TraceRecord traceRing[TRACE_RING_SIZE];
+extern volatile uint32_t traceHead;
+
+// Claims the next slot, retrying if an interrupt claimed one in between
+static inline uint32_t traceClaim(void) {
+#ifdef __MSP432P4111__
+    uint32_t index;
+    do {
+        index = __LDREXW((uint32_t*)&traceHead);
+    } while (__STREXW(index + 1, (uint32_t*)&traceHead));
+    return index;
+#else
+    return __atomic_fetch_add(&traceHead, 1, __ATOMIC_RELAXED);
+#endif
+}
+
+static inline void traceRecord(TraceEvent event, uint32_t a, uint32_t b) {
+    uint32_t index = traceClaim();
+    TraceRecord* record = &traceRing[index & TRACE_MASK];
+
+    record->time = profileNow();
+#ifdef __MSP432P4111__
+    record->context = __get_IPSR();
+#else
+    record->context = 0;
+#endif
+    record->event = event;
+    record->a = a;
+    record->b = b;
+    record->sequence = index;
+}
+
+#define TRACE(event, a, b) traceRecord(event, a, b)
+
+/*
+ * Starts dumping the ring on the telemetry channel.
+ */
+void traceDump(void);
+
+/*
+ * Sends the next lines of a dump, as long as the telemetry queue has room.
+ */
+void traceProcess(void);
+
+/*
+ * Returns true while a dump is in progress.
+ */
+bool traceDumping(void);
+
+void testTrace(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRACE_H_ */
@@ -0,0 +1,34 @@
+/*
+ * traceEvents.h
+ *
+ *      Description: Trace events. The firmware only ever stores an event's
+ *                   index; its format string stays in this file, which
+ *                   tools/tracedecode.py reads to render a dump:
+ *
+ *                   X(event, format)
+ *
+ *                   Formats take the two arguments of the record, both
+ *                   unsigned 32 bit, with printf conversions %u, %x or %c.
+ *                   New events go at the end so older dumps still decode.
+ *
+ *      Author: gibbonec
+ */
+
+#ifndef TRACEEVENTS_H_
+#define TRACEEVENTS_H_
+
+#define TRACE_EVENTS(X) \
+    X(TRACE_UART_RX,        "uart rx byte=0x%02x ring=%u") \
+    X(TRACE_UART_PAUSE,     "uart paused=%u ring=%u") \
+    X(TRACE_LCD_STEP,       "lcd phase=%u depth=%u") \
+    X(TRACE_MARQUEE,        "marquee tick") \
+    X(TRACE_REQUEST_SENT,   "request sent id=%u") \
+    X(TRACE_REQUEST_TIMEOUT, "request timeout id=%u") \
+    X(TRACE_RESPONSE,       "response length=%u ok=%u") \
+    X(TRACE_TOPIC,          "topic %u changed slot=%u") \
+    X(TRACE_ROLLBACK,       "rollback") \
+    X(TRACE_RENDER,         "render dirty=0x%x shown=%u") \
+    X(TRACE_CLOCK,          "clock %u MHz from %u MHz") \
+    X(TRACE_UART_WAKE,      "uart wake byte=0x%02x ring=%u")
+
+#endif /* TRACEEVENTS_H_ */
@@ -0,0 +1,233 @@
+#include "uart.h"
+#include "baud.h"
+#include "profile.h"
+#include "trace.h"
+#include "ramfunc.h"
+#include "clock.h"
+#include "event.h"
+
+#define RING_MASK (RX_RING_SIZE - 1)
+
+UARTStats uartStats;
+
+uint32_t uartClkFreq = 0;
+
+// Receive ring, written by the ISR at head and read by uartRead at tail
+volatile char rxRing[RX_RING_SIZE];
+volatile unsigned int rxHead = 0;
+volatile unsigned int rxTail = 0;
+volatile bool paused = false;
+volatile int flowByte = -1;     // XON or XOFF waiting for the transmitter, or -1
+int wakeByte = -1;      // Byte that wakes the main loop, -1 for every byte
+
+// Sends the waiting XON/XOFF, with the transmit buffer empty
+RAMFUNC void sendFlow(void) {
+    EUSCI_A0->TXBUF = flowByte;
+    flowByte = -1;
+    EUSCI_A0->IE &= ~EUSCI_A_IE_TXIE;
+}
+
+void uartWrite(char c) {
+    while (true) {
+        #ifdef UART_FLOW_HARDWARE
+        // Wait for the forwarder to assert CTS
+        while (CTS_PORT->IN & CTS_MASK);
+        #endif
+
+        while (!(EUSCI_A0->IFG & EUSCI_A_IFG_TXIFG));
+
+        // The ISR may have sent XON/XOFF since the check above
+        __disable_irq();
+        if (EUSCI_A0->IFG & EUSCI_A_IFG_TXIFG) {
+            if (flowByte >= 0) {
+                // A waiting XON/XOFF goes ahead of the byte
+                sendFlow();
+            } else {
+                EUSCI_A0->TXBUF = c;
+                __enable_irq();
+                return;
+            }
+        }
+        __enable_irq();
+    }
+}
+
+// Pauses or resumes the sender. Must be called with the ISR unable to run
+RAMFUNC void setPaused(bool pause) {
+    paused = pause;
+
+    #ifdef UART_FLOW_HARDWARE
+    if (pause) {
+        RTS_PORT->OUT |= RTS_MASK;
+    } else {
+        RTS_PORT->OUT &= ~RTS_MASK;
+    }
+    #else
+    // Sent from the transmit interrupt as soon as the buffer is free, rather than waiting here
+    flowByte = pause ? XOFF : XON;
+    EUSCI_A0->IE |= EUSCI_A_IE_TXIE;
+    #endif
+}
+
+// Recomputes the divisors for the running rate if SMCLK changes
+void uartClock(uint32_t mclk, uint32_t smclk) {
+    if (smclk == uartClkFreq) return;
+    uartClkFreq = smclk;
+    setBaud(uartStats.baud);
+}
+
+void configUART(uint32_t clkFreq) {
+    uartClkFreq = clkFreq;
+    clockSubscribe(uartClock);
+
+    #ifdef UART_FLOW_HARDWARE
+    // Configure RTS as output, initially ready, and CTS as input with pull-down
+    RTS_PORT->SEL0 &= ~RTS_MASK;
+    RTS_PORT->SEL1 &= ~RTS_MASK;
+    RTS_PORT->OUT &= ~RTS_MASK;
+    RTS_PORT->DIR |= RTS_MASK;
+    CTS_PORT->SEL0 &= ~CTS_MASK;
+    CTS_PORT->SEL1 &= ~CTS_MASK;
+    CTS_PORT->DIR &= ~CTS_MASK;
+    CTS_PORT->OUT &= ~CTS_MASK;
+    CTS_PORT->REN |= CTS_MASK;
+    #endif
+
+    // Configure UART pins
+    P1->SEL0 |= BIT2 | BIT3;
+    P1->SEL1 &= ~(BIT2 | BIT3);
+
+    /* Configure UART
+     *  Asynchronous UART mode, 8O1 (8-bit data, even parity, 1 stop bit),
+     *  LSB first, SMCLK clock source
+     */
+    EUSCI_A0->CTLW0 |= EUSCI_A_CTLW0_SWRST;     // Put eUSCI in reset
+    EUSCI_A0->CTLW0 = EUSCI_A_CTLW0_SSEL__SMCLK // SMCLK source
+                // | EUSCI_A_CTLW0_PEN             // Parity enable
+                | EUSCI_A_CTLW0_RXEIE           // Interrupt on erroneous characters so they can be counted
+                | EUSCI_A_CTLW0_SWRST;          // Remain in reset
+
+    /* Baud Rate calculation
+     * Refer to Section 24.3.10 of Technical Reference manual, see baud.h
+     */
+    BaudConfig config = baudCompute(uartClkFreq, UART_BOOT_BAUD);
+    baudApply(EUSCI_A0, &config);
+    uartStats.baud = UART_BOOT_BAUD;
+    uartStats.baudErrorPPM = baudErrorPPM(uartClkFreq, &config);
+
+    EUSCI_A0->CTLW0 &= ~EUSCI_A_CTLW0_SWRST;    // Initialize eUSCI
+    EUSCI_A0->IFG &= ~EUSCI_A_IFG_RXIFG;        // Clear eUSCI RX interrupt flag
+    EUSCI_A0->IE |= EUSCI_A_IE_RXIE;            // Enable USCI_A0 RX interrupt
+
+    // Enable eUSCIA0 interrupt in NVIC module
+    NVIC->ISER[0] = (1 << EUSCIA0_IRQn);
+}
+
+void setBaud(uint32_t baud) {
+    BaudConfig config = baudCompute(uartClkFreq, baud);
+
+    // Let the last byte finish before resetting the module
+    while (EUSCI_A0->STATW & EUSCI_A_STATW_BUSY);
+
+    // Reset clears the interrupt enables, so restore them afterwards
+    uint16_t ie = EUSCI_A0->IE;
+    EUSCI_A0->CTLW0 |= EUSCI_A_CTLW0_SWRST;
+    baudApply(EUSCI_A0, &config);
+    EUSCI_A0->CTLW0 &= ~EUSCI_A_CTLW0_SWRST;
+    EUSCI_A0->IE = ie;
+
+    uartStats.baud = baud;
+    uartStats.baudErrorPPM = baudErrorPPM(uartClkFreq, &config);
+}
+
+void uartWakeOn(int byte) {
+    wakeByte = byte;
+}
+
+unsigned int uartAvailable(void) {
+    return rxHead - rxTail;
+}
+
+int uartRead(void) {
+    if (rxTail == rxHead) return -1;
+
+    char input = rxRing[rxTail & RING_MASK];
+    rxTail++;
+
+    // Resume the sender once there's room again
+    if (paused && rxHead - rxTail <= RX_LOW_WATER) {
+        TRACE(TRACE_UART_PAUSE, false, rxHead - rxTail);
+        __disable_irq();
+        setPaused(false);
+        __enable_irq();
+    }
+
+    return (unsigned char)input;
+}
+
+void uartFlush(void) {
+    __disable_irq();
+    rxTail = rxHead;
+    if (paused) setPaused(false);
+    __enable_irq();
+}
+
+// Moves a received byte into the ring
+RAMFUNC void receiveByte(void) {
+    // Error flags are cleared by reading RX buffer, so check them first
+    uint16_t status = EUSCI_A0->STATW;
+
+    // Note that reading RX buffer clears the flag and removes value from buffer
+    char input = EUSCI_A0->RXBUF;
+
+    if (status & EUSCI_A_STATW_OE) uartStats.overruns++;
+    if (status & EUSCI_A_STATW_FE) {
+        uartStats.framingErrors++;
+        return;
+    }
+
+    unsigned int count = rxHead - rxTail;
+    if (count >= RX_RING_SIZE) {
+        uartStats.dropped++;
+        return;
+    }
+
+    rxRing[rxHead & RING_MASK] = input;
+    rxHead++;
+    count++;
+    #ifdef TRACE_UART_BYTES
+    TRACE(TRACE_UART_RX, (unsigned char)input, count);
+    #endif
+
+    if (count > uartStats.ringHighWater) uartStats.ringHighWater = count;
+
+    // Wake the main loop at the end of a frame, or before the ring fills up
+    if (wakeByte < 0 || (unsigned char)input == wakeByte || count >= RX_HIGH_WATER) {
+        // Only frame boundaries are traced, so the ring spans several responses
+        if ((unsigned char)input == wakeByte) TRACE(TRACE_UART_WAKE, (unsigned char)input, count);
+        eventPost(EVENT_UART);
+    }
+
+    // Pause the sender before the ring fills up
+    if (!paused && count >= RX_HIGH_WATER) {
+        TRACE(TRACE_UART_PAUSE, true, count);
+        setPaused(true);
+        uartStats.pauses++;
+    }
+}
+
+// UART interrupt service routine
+RAMFUNC void EUSCIA0_IRQHandler(void) {
+    PROFILE_BEGIN(PROFILE_UART_ISR);
+
+    if (EUSCI_A0->IFG & EUSCI_A_IFG_RXIFG) {
+        receiveByte();
+    }
+
+    // Only enabled while an XON/XOFF waits
+    if ((EUSCI_A0->IE & EUSCI_A_IE_TXIE) && (EUSCI_A0->IFG & EUSCI_A_IFG_TXIFG)) {
+        sendFlow();
+    }
+
+    PROFILE_END(PROFILE_UART_ISR);
+}
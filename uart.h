@@ -0,0 +1,116 @@
+/*
+ * uart.h
+ *
+ *      Description: eUSCI_A0 UART link to the forwarder. Carries the framed
+ *                   byte stream of frame.h in both directions.
+ *
+ *                   Received bytes are queued in a ring by the ISR and drained
+ *                   with uartRead in the main loop. The sender is paused
+ *                   with XOFF (or by deasserting RTS when UART_FLOW_HARDWARE is
+ *                   defined) when the ring passes its high watermark, so bytes
+ *                   are held back instead of dropped while the main loop is busy.
+ *                   XON and XOFF go out from the transmit interrupt once the
+ *                   byte being sent finishes, so the receive ISR never waits
+ *                   on the transmitter.
+ *
+ *                   Hardware flow control uses the following connections:
+ *                   P3.0 -----> RTS (low when ready to receive)
+ *                   P3.5 <----- CTS (low when the forwarder is ready)
+ *
+ *      Author: gibbonec
+ */
+
+#ifndef UART_H_
+#define UART_H_
+
+#include "msp.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// #define UART_FLOW_HARDWARE
+// #define TRACE_UART_BYTES    // Trace every received byte, which fills the trace ring within one response
+
+#define UART_BOOT_BAUD      38400   // Rate the forwarder listens at after reset
+#define UART_TARGET_BAUD    115200  // Rate requested from the forwarder at startup, up to 1000000
+
+#define RX_RING_SIZE    256 // Must be a power of 2
+#define RX_HIGH_WATER   128 // Pause the sender at this many queued bytes
+#define RX_LOW_WATER    32  // Resume the sender at this many queued bytes
+
+#define XON             0x11
+#define XOFF            0x13
+
+#define RTS_PORT        P3
+#define RTS_MASK        BIT0
+#define CTS_PORT        P3
+#define CTS_MASK        BIT5
+
+// Link error counters
+typedef struct {
+    uint32_t overruns;      // Bytes lost in hardware because RXBUF was not read in time
+    uint32_t framingErrors; // Bytes discarded for a missing stop bit
+    uint32_t dropped;       // Bytes discarded because the receive ring was full
+    uint32_t pauses;        // Times the sender was paused
+    unsigned int ringHighWater; // Most bytes ever queued in the receive ring
+    uint32_t baud;          // Current baud rate
+    int32_t baudErrorPPM;   // Error of the achieved baud rate from the divisors
+} UARTStats;
+
+extern UARTStats uartStats;
+
+/*
+ * Configures P1.2/P1.3 and eUSCI_A0 for UART_BOOT_BAUD from SMCLK and enables
+ *  the receive interrupt.
+ *
+ * \param clkFreq is the frequency of SMCLK in Hz
+ */
+void configUART(uint32_t clkFreq);
+
+/*
+ * Reprograms the baud rate generator for a new rate. Waits for the byte being
+ *  transmitted to finish; anything being received at the time is lost.
+ */
+void setBaud(uint32_t baud);
+
+/*
+ * Writes a single byte, waiting for the transmit buffer (and CTS with hardware
+ *  flow control). An XON/XOFF still waiting for the transmitter goes first.
+ */
+void uartWrite(char c);
+
+/*
+ * Sets the byte whose arrival posts EVENT_UART, e.g. the end of a frame, or -1
+ *  to post on every byte. Reaching RX_HIGH_WATER posts it too.
+ */
+void uartWakeOn(int byte);
+
+/*
+ * Returns the number of bytes waiting in the receive ring.
+ */
+unsigned int uartAvailable(void);
+
+/*
+ * Returns the next received byte, or -1 if there is none. Resumes the sender
+ *  once the receive ring falls below its low watermark.
+ */
+int uartRead(void);
+
+/*
+ * Discards everything in the receive ring and resumes the sender.
+ */
+void uartFlush(void);
+
+/*
+ * Moves the byte in RX buffer into the ring, the body of the receive interrupt.
+ */
+void receiveByte(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UART_H_ */